@@ -1,187 +1,553 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#define PRIME_LIMIT 65536   // covers sqrt of any 32-bit value
+#define PRIME_ROOT 256      // sqrt(PRIME_LIMIT)
+#define MAX_PRIMES 6542     // primes below PRIME_LIMIT
+#define SIEVE_SEGMENT 8192
+#define MAX_FACTORS 63      // a 64-bit value has at most 63 prime factors
+#define TRIAL_CUTOFF 1024   // largest trial divisor for 64-bit cofactors
+#define RHO_BLOCK 128       // gcd batching in Pollard-Brent
+#define MAX_WORKERS 256
+#define CACHE_SHARDS 64
+#define CACHE_SHARD_ENTRIES 512         // per shard; a power of two
+#define CACHE_MAX_FACTORS 15
+#define CACHE_MIN_VALUE (1u << 20)      // smaller values factor faster than a lookup
+
+typedef unsigned __int128 u128;
 
 /*
-  Thread returns this struct via pthread_exit().
+  Workers store one of these per input slot.
   Parent frees it after printing.
 */
 typedef struct {
-    int original;
+    uint64_t original;
     int count;
-    int *factors;   // dynamically allocated array of factors
+    uint64_t *factors;   // dynamically allocated array of factors
 } factor_result_t;
 
+/*
+  Shared by all workers. Each worker claims the next input index with an
+  atomic increment and writes its result into the matching slot, so no
+  two workers ever touch the same slot.
+*/
 typedef struct {
-    int value;
-} thread_arg_t;
+    const uint64_t *values;
+    factor_result_t **results;
+    int count;
+    atomic_int next;
+} work_pool_t;
 
 /*
-  Trial division factorization.
-  Produces factors in nondecreasing order naturally.
+  All primes below PRIME_LIMIT. Filled once by main() before any thread is
+  created and only read afterwards, so threads share it without locking.
 */
-static factor_result_t *factor_number(int n) {
-    factor_result_t *res = (factor_result_t *)malloc(sizeof(factor_result_t));
-    if (!res) return NULL;
+static int primes[MAX_PRIMES];
+static int nprimes = 0;
 
-    res->original = n;
-    res->count = 0;
+/*
+  Segmented sieve: base primes up to PRIME_ROOT come from a plain sieve,
+  then each cache-sized segment is crossed off with them.
+*/
+static void build_prime_table(void) {
+    char small[PRIME_ROOT + 1];
+    int base[PRIME_ROOT];
+    int nbase = 0;
 
-    // Max prime factors is stated as 10, but allocate a bit more safely.
-    int capacity = 16;
-    res->factors = (int *)malloc(sizeof(int) * capacity);
-    if (!res->factors) {
-        free(res);
-        return NULL;
+    memset(small, 1, sizeof(small));
+    for (int i = 2; i <= PRIME_ROOT; i++) {
+        if (!small[i]) continue;
+        base[nbase++] = i;
+        for (int m = i * i; m <= PRIME_ROOT; m += i) small[m] = 0;
     }
 
-    int x = n;
+    char seg[SIEVE_SEGMENT];
+    for (int lo = 2; lo < PRIME_LIMIT; lo += SIEVE_SEGMENT) {
+        int hi = lo + SIEVE_SEGMENT;
+        if (hi > PRIME_LIMIT) hi = PRIME_LIMIT;
 
-    // Factor out 2s
-    while (x % 2 == 0) {
-        if (res->count == capacity) {
-            capacity *= 2;
-            int *tmp = (int *)realloc(res->factors, sizeof(int) * capacity);
-            if (!tmp) {
-                free(res->factors);
-                free(res);
-                return NULL;
-            }
-            res->factors = tmp;
+        memset(seg, 1, hi - lo);
+        for (int k = 0; k < nbase; k++) {
+            int p = base[k];
+            int start = (lo + p - 1) / p * p;
+            if (start < p * p) start = p * p;
+            for (int m = start; m < hi; m += p) seg[m - lo] = 0;
+        }
+        for (int i = lo; i < hi; i++) {
+            if (seg[i - lo]) primes[nprimes++] = i;
+        }
+    }
+}
+
+/*
+  Arithmetic modulo an odd 64-bit n in Montgomery form (R = 2^64).
+*/
+typedef struct {
+    uint64_t n;
+    uint64_t ninv;  // n * ninv == 1 (mod 2^64)
+    uint64_t r2;    // R^2 mod n
+    uint64_t one;   // R mod n
+} montgomery_t;
+
+static void mont_init(montgomery_t *m, uint64_t n) {
+    m->n = n;
+    m->ninv = n;  // correct to 3 bits; each Newton step doubles that
+    for (int i = 0; i < 5; i++) m->ninv *= 2 - n * m->ninv;
+    m->one = (0 - n) % n;
+    m->r2 = (uint64_t)((u128)m->one * m->one % n);
+}
+
+static uint64_t mont_mul(const montgomery_t *m, uint64_t a, uint64_t b) {
+    u128 t = (u128)a * b;
+    uint64_t q = (uint64_t)t * m->ninv;
+    uint64_t hi = (uint64_t)(t >> 64);
+    uint64_t qn = (uint64_t)(((u128)q * m->n) >> 64);
+    return hi >= qn ? hi - qn : hi - qn + m->n;
+}
+
+static uint64_t mont_to(const montgomery_t *m, uint64_t a) {
+    return mont_mul(m, a % m->n, m->r2);
+}
+
+static uint64_t mont_add(const montgomery_t *m, uint64_t a, uint64_t b) {
+    uint64_t s = a + b;
+    return (s < a || s >= m->n) ? s - m->n : s;
+}
+
+static uint64_t mont_pow(const montgomery_t *m, uint64_t a, uint64_t e) {
+    uint64_t r = m->one;
+    while (e) {
+        if (e & 1) r = mont_mul(m, r, a);
+        a = mont_mul(m, a, a);
+        e >>= 1;
+    }
+    return r;
+}
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    do {
+        b >>= __builtin_ctzll(b);
+        if (a > b) {
+            uint64_t t = a;
+            a = b;
+            b = t;
+        }
+        b -= a;
+    } while (b);
+    return a << shift;
+}
+
+/*
+  Deterministic Miller-Rabin: these seven bases are exact for all n < 2^64.
+*/
+static int is_prime_u64(uint64_t n) {
+    static const uint64_t small[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    static const uint64_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+    if (n < 2) return 0;
+    for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+        if (n % small[i] == 0) return n == small[i];
+    }
+    if (n < 37 * 37) return 1;
+
+    uint64_t d = n - 1;
+    int s = __builtin_ctzll(d);
+    d >>= s;
+
+    montgomery_t m;
+    mont_init(&m, n);
+    uint64_t minus_one = n - m.one;
+
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        uint64_t a = bases[i] % n;
+        if (a == 0) continue;
+
+        uint64_t x = mont_pow(&m, mont_to(&m, a), d);
+        if (x == m.one || x == minus_one) continue;
+
+        int witness = 1;
+        for (int r = 1; r < s && witness; r++) {
+            x = mont_mul(&m, x, x);
+            if (x == minus_one) witness = 0;
         }
-        res->factors[res->count++] = 2;
-        x /= 2;
-    }
-
-    // Factor odd divisors
-    for (int d = 3; (long long)d * d <= x; d += 2) {
-        while (x % d == 0) {
-            if (res->count == capacity) {
-                capacity *= 2;
-                int *tmp = (int *)realloc(res->factors, sizeof(int) * capacity);
-                if (!tmp) {
-                    free(res->factors);
-                    free(res);
-                    return NULL;
+        if (witness) return 0;
+    }
+    return 1;
+}
+
+/*
+  Pollard rho with Brent's cycle detection on f(y) = y^2 + c.
+  Differences are multiplied together RHO_BLOCK at a time so only one gcd
+  is taken per block; a block that overshoots to gcd == n is replayed one
+  step at a time. n must be odd and composite.
+*/
+static uint64_t pollard_brent(uint64_t n) {
+    montgomery_t m;
+    mont_init(&m, n);
+
+    for (uint64_t c0 = 1;; c0++) {
+        uint64_t c = mont_to(&m, c0);
+        uint64_t y = mont_to(&m, 2), x = y, ys = y;
+        uint64_t q = m.one;
+        uint64_t g = 1;
+
+        for (uint64_t r = 1; g == 1; r <<= 1) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = mont_add(&m, mont_mul(&m, y, y), c);
+
+            for (uint64_t k = 0; k < r && g == 1; k += RHO_BLOCK) {
+                ys = y;
+                uint64_t lim = r - k < RHO_BLOCK ? r - k : RHO_BLOCK;
+                for (uint64_t i = 0; i < lim; i++) {
+                    y = mont_add(&m, mont_mul(&m, y, y), c);
+                    q = mont_mul(&m, q, x > y ? x - y : y - x);
                 }
-                res->factors = tmp;
+                g = gcd_u64(q, n);
             }
-            res->factors[res->count++] = d;
-            x /= d;
         }
+
+        if (g == n) {
+            do {
+                ys = mont_add(&m, mont_mul(&m, ys, ys), c);
+                g = gcd_u64(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+
+        if (g != n) return g;
     }
+}
 
-    // If remainder is > 1, it's a prime factor
-    if (x > 1) {
-        if (res->count == capacity) {
-            capacity *= 2;
-            int *tmp = (int *)realloc(res->factors, sizeof(int) * capacity);
-            if (!tmp) {
-                free(res->factors);
-                free(res);
-                return NULL;
-            }
-            res->factors = tmp;
+/*
+  Splits an odd cofactor with no small factors into primes (unsorted).
+*/
+static void factor_large(uint64_t n, factor_result_t *res) {
+    if (n == 1) return;
+    if (is_prime_u64(n)) {
+        res->factors[res->count++] = n;
+        return;
+    }
+    uint64_t d = pollard_brent(n);
+    factor_large(d, res);
+    factor_large(n / d, res);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+  Size-bounded map from a number to its sorted prime factors, shared by all
+  workers. Keys hash to one of CACHE_SHARDS shards, each a direct-mapped
+  table behind its own mutex; a colliding insert evicts the old entry.
+  Factorizations longer than CACHE_MAX_FACTORS are not cached.
+*/
+typedef struct {
+    uint64_t key;   // 0 marks an empty slot; inputs are always >= 2
+    int count;
+    uint64_t factors[CACHE_MAX_FACTORS];
+} cache_entry_t;
+
+typedef struct {
+    pthread_mutex_t mtx;
+    unsigned long hits;
+    unsigned long misses;
+    cache_entry_t slots[CACHE_SHARD_ENTRIES];
+} cache_shard_t;
+
+static cache_shard_t cache[CACHE_SHARDS];
+
+static void cache_init(void) {
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        pthread_mutex_init(&cache[i].mtx, NULL);
+    }
+}
+
+static uint64_t cache_hash(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return k;
+}
+
+/*
+  On a hit, appends the cached factors of key to res.
+*/
+static int cache_lookup(uint64_t key, factor_result_t *res) {
+    uint64_t h = cache_hash(key);
+    cache_shard_t *sh = &cache[h % CACHE_SHARDS];
+
+    pthread_mutex_lock(&sh->mtx);
+    const cache_entry_t *e = &sh->slots[(h >> 32) % CACHE_SHARD_ENTRIES];
+    int hit = e->key == key;
+    if (hit) {
+        memcpy(res->factors + res->count, e->factors, e->count * sizeof(uint64_t));
+        res->count += e->count;
+        sh->hits++;
+    } else {
+        sh->misses++;
+    }
+    pthread_mutex_unlock(&sh->mtx);
+    return hit;
+}
+
+static void cache_insert(uint64_t key, const uint64_t *factors, int count) {
+    if (count > CACHE_MAX_FACTORS) return;
+
+    uint64_t h = cache_hash(key);
+    cache_shard_t *sh = &cache[h % CACHE_SHARDS];
+
+    pthread_mutex_lock(&sh->mtx);
+    cache_entry_t *e = &sh->slots[(h >> 32) % CACHE_SHARD_ENTRIES];
+    e->key = key;
+    e->count = count;
+    memcpy(e->factors, factors, count * sizeof(uint64_t));
+    pthread_mutex_unlock(&sh->mtx);
+}
+
+/*
+  One factorization's cache traffic. Every cofactor that missed is
+  remembered with the index where its factors start in res; since factors
+  come out in nondecreasing order, its factorization is exactly that suffix.
+*/
+typedef struct {
+    factor_result_t *res;
+    int nmissed;
+    uint64_t missed[MAX_FACTORS + 1];
+    int missed_at[MAX_FACTORS + 1];
+} cache_probe_t;
+
+static int probe_hit(cache_probe_t *probe, uint64_t x) {
+    if (x < CACHE_MIN_VALUE) return 0;
+    if (cache_lookup(x, probe->res)) return 1;
+    probe->missed[probe->nmissed] = x;
+    probe->missed_at[probe->nmissed++] = probe->res->count;
+    return 0;
+}
+
+static void probe_remember(cache_probe_t *probe) {
+    factor_result_t *res = probe->res;
+    for (int i = 0; i < probe->nmissed; i++) {
+        cache_insert(probe->missed[i], res->factors + probe->missed_at[i],
+                     res->count - probe->missed_at[i]);
+    }
+}
+
+/*
+  Trial division by the primes in the table, then Miller-Rabin and
+  Pollard rho for whatever is left. Values below 2^32 are finished by the
+  table alone. The cache is consulted again each time trial division
+  shrinks the cofactor.
+*/
+static void factor_cofactor(uint64_t x, factor_result_t *res, cache_probe_t *probe) {
+    int exhausted = 0;
+
+    // Only prime divisors need testing
+    for (int k = 0; k < nprimes; k++) {
+        uint64_t d = primes[k];
+        if (d * d > x) {
+            exhausted = 1;
+            break;
         }
+        if (d > TRIAL_CUTOFF && x > UINT32_MAX) break;
+        if (x % d != 0) continue;
+
+        do {
+            res->factors[res->count++] = d;
+            x /= d;
+        } while (x % d == 0);
+
+        if (probe_hit(probe, x)) return;
+    }
+
+    if (x == 1) return;
+
+    // If trial division covered sqrt(x), the remainder is a prime factor
+    if (exhausted || x <= UINT32_MAX) {
         res->factors[res->count++] = x;
+        return;
     }
 
+    int first = res->count;
+    factor_large(x, res);
+    qsort(res->factors + first, res->count - first, sizeof(uint64_t), cmp_u64);
+}
+
+/*
+  Produces factors in nondecreasing order.
+*/
+static factor_result_t *factor_number(uint64_t n) {
+    factor_result_t *res = (factor_result_t *)malloc(sizeof(factor_result_t));
+    if (!res) return NULL;
+
+    res->original = n;
+    res->count = 0;
+
+    res->factors = (uint64_t *)malloc(sizeof(uint64_t) * MAX_FACTORS);
+    if (!res->factors) {
+        free(res);
+        return NULL;
+    }
+
+    cache_probe_t probe;
+    probe.res = res;
+    probe.nmissed = 0;
+
+    if (!probe_hit(&probe, n)) factor_cofactor(n, res, &probe);
+    probe_remember(&probe);
+
     return res;
 }
 
-static void *thread_main(void *arg) {
-    thread_arg_t *targ = (thread_arg_t *)arg;
-    int n = targ->value;
+/*
+  Decimal digits only (no sign), and the whole string must fit in 64 bits.
+*/
+static int parse_u64(const char *s, uint64_t *out) {
+    if (*s < '0' || *s > '9') return 0;
+    errno = 0;
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (errno != 0 || *end != '\0') return 0;
+    *out = v;
+    return 1;
+}
 
-    factor_result_t *res = factor_number(n);
+static void *worker_main(void *arg) {
+    work_pool_t *pool = (work_pool_t *)arg;
 
-    // Free the argument struct allocated by parent
-    free(targ);
+    int i;
+    while ((i = atomic_fetch_add(&pool->next, 1)) < pool->count) {
+        pool->results[i] = factor_number(pool->values[i]);
+    }
 
-    // Return result struct pointer to parent
-    pthread_exit((void *)res);
     return NULL;
 }
 
+static int default_workers(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_WORKERS) return MAX_WORKERS;
+    return (int)n;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        printf("Usage:%s <number to factor>...\n", argv[0]);
-        return 0;
+    // Optional leading -s prints cache hit/miss counters to stderr
+    int first = 1;
+    int show_stats = 0;
+    if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+        show_stats = 1;
+        first = 2;
     }
 
-    int num_threads = argc - 1;
-
-    // Per assignment: no more than 25 numbers
-    if (num_threads > 25) {
-        fprintf(stderr, "Error: too many numbers (max 25).\n");
-        return 1;
+    if (argc - first < 1) {
+        printf("Usage:%s [-s] <number to factor>...\n", argv[0]);
+        return 0;
     }
 
-    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
+    int count = argc - first;
 
-    if (!threads) {
+    uint64_t *values = (uint64_t *)malloc(sizeof(uint64_t) * count);
+    factor_result_t **results = (factor_result_t **)calloc(count, sizeof(factor_result_t *));
+    if (!values || !results) {
         perror("malloc");
+        free(values);
+        free(results);
         return 1;
     }
 
-    // 1) Create ALL threads first
-    for (int i = 0; i < num_threads; i++) {
-        int n = atoi(argv[i + 1]);
-
+    // 1) Validate every argument before starting any work
+    for (int i = 0; i < count; i++) {
         // Simplification says smallest is 2, but guard anyway
-        if (n < 2) {
-            fprintf(stderr, "Error: invalid input '%s' (must be >= 2)\n", argv[i + 1]);
-            free(threads);
+        if (!parse_u64(argv[first + i], &values[i]) || values[i] < 2) {
+            fprintf(stderr, "Error: invalid input '%s' (must be >= 2 and fit in 64 bits)\n", argv[first + i]);
+            free(values);
+            free(results);
             return 1;
         }
+    }
 
-        thread_arg_t *targ = (thread_arg_t *)malloc(sizeof(thread_arg_t));
-        if (!targ) {
-            perror("malloc");
-            free(threads);
-            return 1;
-        }
-        targ->value = n;
+    build_prime_table();
+    cache_init();
+
+    // 2) A fixed pool of workers pulls indices until the input runs out
+    work_pool_t pool;
+    pool.values = values;
+    pool.results = results;
+    pool.count = count;
+    atomic_init(&pool.next, 0);
 
-        int rc = pthread_create(&threads[i], NULL, thread_main, (void *)targ);
+    int num_threads = default_workers();
+    if (num_threads > count) num_threads = count;
+
+    pthread_t threads[MAX_WORKERS];
+    int started = 0;
+    for (; started < num_threads; started++) {
+        int rc = pthread_create(&threads[started], NULL, worker_main, &pool);
         if (rc != 0) {
+            // The workers already running will cover every slot
+            if (started > 0) break;
             fprintf(stderr, "Error: pthread_create failed (code %d)\n", rc);
-            free(targ);
-            free(threads);
+            free(values);
+            free(results);
             return 1;
         }
     }
 
-    // 2) Join in the same order as arguments and print from main thread only
-    for (int i = 0; i < num_threads; i++) {
-        void *retval = NULL;
-
-        int rc = pthread_join(threads[i], &retval);
+    for (int t = 0; t < started; t++) {
+        int rc = pthread_join(threads[t], NULL);
         if (rc != 0) {
             fprintf(stderr, "Error: pthread_join failed (code %d)\n", rc);
-            free(threads);
             return 1;
         }
+    }
 
-        factor_result_t *res = (factor_result_t *)retval;
+    // 3) Print in the same order as arguments from main thread only
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        factor_result_t *res = results[i];
         if (!res) {
             fprintf(stderr, "Error: factorization failed (out of memory)\n");
-            free(threads);
-            return 1;
+            status = 1;
+            break;
         }
 
-        printf("%d:", res->original);
+        printf("%" PRIu64 ":", res->original);
         for (int k = 0; k < res->count; k++) {
-            printf(" %d", res->factors[k]);
+            printf(" %" PRIu64, res->factors[k]);
         }
         printf("\n");
+    }
 
-        free(res->factors);
-        free(res);
+    if (show_stats) {
+        unsigned long hits = 0, misses = 0;
+        for (int i = 0; i < CACHE_SHARDS; i++) {
+            hits += cache[i].hits;
+            misses += cache[i].misses;
+        }
+        unsigned long total = hits + misses;
+        fflush(stdout);
+        fprintf(stderr, "Cache: %lu hits, %lu misses (%.1f%% hit rate)\n",
+                hits, misses, total ? 100.0 * hits / total : 0.0);
     }
 
-    free(threads);
-    return 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i]) {
+            free(results[i]->factors);
+            free(results[i]);
+        }
+    }
+    free(results);
+    free(values);
+    return status;
 }
-
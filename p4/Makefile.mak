@@ -1,5 +1,14 @@
-all:
-	g++ -o p4 p4.cpp
-
-clean:
-	rm -f p4
+CXX=g++
+CXXFLAGS=-Wall -Wextra -O2 -pthread
+BENCH_RANGE=3-6
+
+all: p4
+
+p4: p4.cpp
+	$(CXX) $(CXXFLAGS) -o p4 p4.cpp
+
+bench: p4
+	./p4 -B $(BENCH_RANGE)
+
+clean:
+	rm -f p4
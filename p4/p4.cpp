@@ -1,295 +1,1667 @@
-#include <iostream>
-#include <vector>
-#include <queue>
-#include <iomanip>
-#include <string>
-#include <limits>
-
-using namespace std;
-
-struct Stats {
-    double avgResp;
-    double avgTA;
-    double avgWait;
-};
-
-static const int MAXP = 100;
-
-Stats runFCFS(const vector<int>& arrival, const vector<int>& burst) {
-    int n = (int)arrival.size();
-
-    long long sumResp = 0, sumTA = 0, sumWait = 0;
-
-    long long t = 0;
-
-    for (int i = 0; i < n; i++) {
-        if (t < arrival[i]) t = arrival[i];
-
-        long long start = t;
-        long long finish = t + burst[i];
-
-        long long resp = start - arrival[i];
-        long long ta = finish - arrival[i];
-        long long wait = ta - burst[i];
-
-        sumResp += resp;
-        sumTA += ta;
-        sumWait += wait;
-
-        t = finish;
-    }
-
-    Stats s;
-    s.avgResp = (double)sumResp / n;
-    s.avgTA = (double)sumTA / n;
-    s.avgWait = (double)sumWait / n;
-    return s;
-}
-
-Stats runSJF(const vector<int>& arrival, const vector<int>& burst) {
-    int n = (int)arrival.size();
-
-    vector<bool> done(n, false);
-
-    long long sumResp = 0, sumTA = 0, sumWait = 0;
-    long long t = 0;
-    int finished = 0;
-
-    while (finished < n) {
-        int best = -1;
-
-        // find all arrived & not done, pick smallest burst
-        for (int i = 0; i < n; i++) {
-            if (!done[i] && arrival[i] <= t) {
-                if (best == -1 || burst[i] < burst[best]) {
-                    best = i;
-                }
-            }
-        }
-
-        if (best == -1) {
-            // no process ready, jump time to next arrival
-            long long nextArr = LLONG_MAX;
-            for (int i = 0; i < n; i++) {
-                if (!done[i]) nextArr = min(nextArr, (long long)arrival[i]);
-            }
-            t = nextArr;
-            continue;
-        }
-
-        long long start = t;
-        long long finish = t + burst[best];
-
-        long long resp = start - arrival[best];
-        long long ta = finish - arrival[best];
-        long long wait = ta - burst[best];
-
-        sumResp += resp;
-        sumTA += ta;
-        sumWait += wait;
-
-        t = finish;
-        done[best] = true;
-        finished++;
-    }
-
-    Stats s;
-    s.avgResp = (double)sumResp / n;
-    s.avgTA = (double)sumTA / n;
-    s.avgWait = (double)sumWait / n;
-    return s;
-}
-
-Stats runSRTF(const vector<int>& arrival, const vector<int>& burst) {
-    int n = (int)arrival.size();
-
-    vector<int> remaining = burst;
-    vector<int> firstStart(n, -1);
-    vector<int> finishTime(n, -1);
-
-    long long t = 0;
-    int finished = 0;
-
-    while (finished < n) {
-        int best = -1;
-
-        // pick arrived with smallest remaining time
-        for (int i = 0; i < n; i++) {
-            if (remaining[i] > 0 && arrival[i] <= t) {
-                if (best == -1 || remaining[i] < remaining[best]) {
-                    best = i;
-                }
-            }
-        }
-
-        if (best == -1) {
-            // jump to next arrival
-            long long nextArr = LLONG_MAX;
-            for (int i = 0; i < n; i++) {
-                if (remaining[i] > 0) nextArr = min(nextArr, (long long)arrival[i]);
-            }
-            t = nextArr;
-            continue;
-        }
-
-        if (firstStart[best] == -1) firstStart[best] = (int)t;
-
-        // Run until either it finishes OR a new process arrives that could preempt.
-        long long nextArrival = LLONG_MAX;
-        for (int i = 0; i < n; i++) {
-            if (remaining[i] > 0 && arrival[i] > t) {
-                nextArrival = min(nextArrival, (long long)arrival[i]);
-            }
-        }
-
-        long long runFor;
-        if (nextArrival == LLONG_MAX) {
-            runFor = remaining[best];
-        } else {
-            runFor = min((long long)remaining[best], nextArrival - t);
-        }
-
-        remaining[best] -= (int)runFor;
-        t += runFor;
-
-        if (remaining[best] == 0) {
-            finishTime[best] = (int)t;
-            finished++;
-        }
-    }
-
-    long long sumResp = 0, sumTA = 0, sumWait = 0;
-
-    for (int i = 0; i < n; i++) {
-        long long resp = firstStart[i] - arrival[i];
-        long long ta = finishTime[i] - arrival[i];
-        long long wait = ta - burst[i];
-
-        sumResp += resp;
-        sumTA += ta;
-        sumWait += wait;
-    }
-
-    Stats s;
-    s.avgResp = (double)sumResp / n;
-    s.avgTA = (double)sumTA / n;
-    s.avgWait = (double)sumWait / n;
-    return s;
-}
-
-Stats runRR(const vector<int>& arrival, const vector<int>& burst, int quantum) {
-    int n = (int)arrival.size();
-
-    vector<int> remaining = burst;
-    vector<int> firstStart(n, -1);
-    vector<int> finishTime(n, -1);
-
-    queue<int> rq;
-
-    long long t = 0;
-    int finished = 0;
-    int nextToArrive = 0;
-
-    // jump to first arrival
-    t = arrival[0];
-    rq.push(0);
-    nextToArrive = 1;
-
-    while (finished < n) {
-        if (rq.empty()) {
-            // jump to next arrival
-            t = arrival[nextToArrive];
-            rq.push(nextToArrive);
-            nextToArrive++;
-        }
-
-        int p = rq.front();
-        rq.pop();
-
-        if (firstStart[p] == -1) firstStart[p] = (int)t;
-
-        int slice = min(quantum, remaining[p]);
-        long long endTime = t + slice;
-
-        // IMPORTANT RULE:
-        // Add any processes that arrive during this slice BEFORE re-adding p.
-        while (nextToArrive < n && arrival[nextToArrive] <= endTime) {
-            rq.push(nextToArrive);
-            nextToArrive++;
-        }
-
-        remaining[p] -= slice;
-        t = endTime;
-
-        if (remaining[p] == 0) {
-            finishTime[p] = (int)t;
-            finished++;
-        } else {
-            rq.push(p);
-        }
-    }
-
-    long long sumResp = 0, sumTA = 0, sumWait = 0;
-
-    for (int i = 0; i < n; i++) {
-        long long resp = firstStart[i] - arrival[i];
-        long long ta = finishTime[i] - arrival[i];
-        long long wait = ta - burst[i];
-
-        sumResp += resp;
-        sumTA += ta;
-        sumWait += wait;
-    }
-
-    Stats s;
-    s.avgResp = (double)sumResp / n;
-    s.avgTA = (double)sumTA / n;
-    s.avgWait = (double)sumWait / n;
-    return s;
-}
-
-static void printStats(const Stats& s) {
-    cout << fixed << setprecision(2);
-    cout << "Avg. Resp.:" << s.avgResp
-         << ", Avg. T.A.:" << s.avgTA
-         << ", Avg. Wait:" << s.avgWait << "\n";
-}
-
-int main(int argc, char* argv[]) {
-    int quantum = 100;
-    if (argc >= 2) quantum = stoi(argv[1]);
-
-    vector<int> arrival;
-    vector<int> burst;
-
-    int a, b;
-    while (cin >> a >> b) {
-        if ((int)arrival.size() >= MAXP) break;
-        arrival.push_back(a);
-        burst.push_back(b);
-    }
-
-    if (arrival.empty()) return 0;
-
-    Stats fcfs = runFCFS(arrival, burst);
-    Stats sjf = runSJF(arrival, burst);
-    Stats srtf = runSRTF(arrival, burst);
-    Stats rr = runRR(arrival, burst, quantum);
-
-    cout << "First Come, First Served\n";
-    printStats(fcfs);
-    cout << "\n";
-
-    cout << "Shortest Job First\n";
-    printStats(sjf);
-    cout << "\n";
-
-    cout << "Shortest Remaining Time First\n";
-    printStats(srtf);
-    cout << "\n";
-
-    cout << "Round Robin with Time Quantum of " << quantum << "\n";
-    printStats(rr);
-
-    return 0;
-}
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <deque>
+#include <set>
+#include <tuple>
+#include <iomanip>
+#include <string>
+#include <limits>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct Percentiles {
+    long long p50;
+    long long p90;
+    long long p99;
+    long long p999;
+    long long max;
+};
+
+struct Stats {
+    double avgResp;
+    double avgTA;
+    double avgWait;
+    Percentiles resp;
+    Percentiles ta;
+    Percentiles wait;
+};
+
+// Log-bucketed latency histogram in the HDR histogram layout: values below
+// HIST_SUB get a bucket each, and every power of two above that is split
+// into HIST_SUB / 2 buckets. A percentile is reported as the top of its
+// bucket, which is within 1/64 of the true value, and memory stays at
+// HIST_BUCKETS counters however long the trace is.
+static const int HIST_SUB_BITS = 7;
+static const int HIST_SUB = 1 << HIST_SUB_BITS;
+static const int HIST_HALF = HIST_SUB / 2;
+static const int HIST_BUCKETS = (63 - HIST_SUB_BITS) * HIST_HALF + HIST_SUB;
+
+class Histogram {
+public:
+    Histogram() : counts(HIST_BUCKETS, 0) {}
+
+    void record(long long v) {
+        sum += v;
+        n++;
+        if (v < 0) v = 0;  // only possible for an unsorted trace
+        if (v > maxValue) maxValue = v;
+        counts[bucketOf(v)]++;
+    }
+
+    double mean() const { return (double)sum / n; }
+
+    Percentiles percentiles() const {
+        Percentiles p;
+        p.p50 = valueAt(0.50);
+        p.p90 = valueAt(0.90);
+        p.p99 = valueAt(0.99);
+        p.p999 = valueAt(0.999);
+        p.max = maxValue;
+        return p;
+    }
+
+private:
+    static int bucketOf(long long v) {
+        if (v < HIST_SUB) return (int)v;
+        int shift = 63 - __builtin_clzll((unsigned long long)v) - (HIST_SUB_BITS - 1);
+        return shift * HIST_HALF + (int)(v >> shift);
+    }
+
+    static long long bucketTop(int b) {
+        if (b < HIST_SUB) return b;
+        int shift = b / HIST_HALF - 1;
+        long long mantissa = b % HIST_HALF + HIST_HALF;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    long long valueAt(double q) const {
+        long long rank = (long long)ceil(q * n);
+        if (rank < 1) rank = 1;
+        long long seen = 0;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank) return min(bucketTop(b), maxValue);
+        }
+        return maxValue;
+    }
+
+    vector<long long> counts;
+    long long sum = 0;
+    long long n = 0;
+    long long maxValue = 0;
+};
+
+// Response, turnaround and wait for every finished process of one run.
+struct LatencyRecorder {
+    Histogram resp;
+    Histogram ta;
+    Histogram wait;
+
+    void record(long long r, long long t, long long w) {
+        resp.record(r);
+        ta.record(t);
+        wait.record(w);
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.avgResp = resp.mean();
+        s.avgTA = ta.mean();
+        s.avgWait = wait.mean();
+        s.resp = resp.percentiles();
+        s.ta = ta.percentiles();
+        s.wait = wait.percentiles();
+        return s;
+    }
+};
+
+// The trace as a struct of arrays. It is filled once, then shared read-only
+// by every policy (possibly on several threads at once), so policies keep
+// their own state in their ready queues rather than in per-process columns.
+struct ProcessTable {
+    vector<long long> arrival;
+    vector<long long> burst;
+    // Process indices ordered by arrival (ties keep input order).
+    vector<int> order;
+
+    int size() const { return (int)arrival.size(); }
+
+    void add(long long a, long long b) {
+        arrival.push_back(a);
+        burst.push_back(b);
+    }
+
+    // Builds `order`; call once after the last add(). Traces are normally
+    // already sorted, in which case this is a single pass.
+    void seal() {
+        int n = size();
+        order.resize(n);
+        for (int i = 0; i < n; i++) order[i] = i;
+        if (!is_sorted(arrival.begin(), arrival.end())) {
+            stable_sort(order.begin(), order.end(),
+                        [&](int a, int b) { return arrival[a] < arrival[b]; });
+        }
+    }
+};
+
+// Ready-queue entry: (key, process index). Ordering on the pair breaks key
+// ties toward the lower index, same as a first-match linear scan would.
+typedef pair<long long, int> ReadyEntry;
+typedef priority_queue<ReadyEntry, vector<ReadyEntry>, greater<ReadyEntry>> ReadyHeap;
+
+// Both FCFS and RR only ever look at jobs in arrival order, so they are
+// written as incremental simulators: jobs are fed one at a time with add()
+// and only the jobs still in the system are kept. Arrivals must be
+// nondecreasing.
+class FcfsSim {
+public:
+    void add(long long arrival, long long burst) {
+        if (t < arrival) t = arrival;
+
+        long long start = t;
+        long long finish = t + burst;
+
+        long long resp = start - arrival;
+        long long ta = finish - arrival;
+        long long wait = ta - burst;
+
+        lat.record(resp, ta, wait);
+
+        t = finish;
+    }
+
+    Stats finish() const { return lat.stats(); }
+
+private:
+    LatencyRecorder lat;
+    long long t = 0;
+};
+
+Stats runFCFS(const ProcessTable& procs) {
+    FcfsSim sim;
+    for (int i = 0; i < procs.size(); i++) sim.add(procs.arrival[i], procs.burst[i]);
+    return sim.finish();
+}
+
+Stats runSJF(const ProcessTable& procs) {
+    int n = procs.size();
+    const vector<long long>& arrival = procs.arrival;
+    const vector<long long>& burst = procs.burst;
+    const vector<int>& order = procs.order;
+
+    ReadyHeap ready;  // keyed on burst
+
+    LatencyRecorder lat;
+    long long t = 0;
+    int finished = 0;
+    int next = 0;
+
+    while (finished < n) {
+        // admit everything that has arrived by now
+        while (next < n && arrival[order[next]] <= t) {
+            int i = order[next++];
+            ready.push(ReadyEntry(burst[i], i));
+        }
+
+        if (ready.empty()) {
+            // no process ready, jump time to next arrival
+            t = arrival[order[next]];
+            continue;
+        }
+
+        int best = ready.top().second;
+        ready.pop();
+
+        long long start = t;
+        long long finish = t + burst[best];
+
+        long long resp = start - arrival[best];
+        long long ta = finish - arrival[best];
+        long long wait = ta - burst[best];
+
+        lat.record(resp, ta, wait);
+
+        t = finish;
+        finished++;
+    }
+
+    return lat.stats();
+}
+
+Stats runSRTF(const ProcessTable& procs) {
+    int n = procs.size();
+    const vector<long long>& arrival = procs.arrival;
+    const vector<long long>& burst = procs.burst;
+    const vector<int>& order = procs.order;
+
+    ReadyHeap ready;  // keyed on remaining time
+
+    LatencyRecorder lat;
+    long long t = 0;
+    int finished = 0;
+    int next = 0;
+
+    while (finished < n) {
+        while (next < n && arrival[order[next]] <= t) {
+            int i = order[next++];
+            ready.push(ReadyEntry(burst[i], i));
+        }
+
+        if (ready.empty()) {
+            // jump to next arrival
+            t = arrival[order[next]];
+            continue;
+        }
+
+        long long remaining = ready.top().first;
+        int best = ready.top().second;
+        ready.pop();
+
+        // Every slice runs for at least one tick, so a process that still
+        // has its whole burst left is starting for the first time.
+        if (remaining == burst[best]) lat.resp.record(t - arrival[best]);
+
+        // Run until either it finishes OR a new process arrives that could preempt.
+        long long runFor = remaining;
+        if (next < n) {
+            runFor = min(runFor, arrival[order[next]] - t);
+        }
+
+        remaining -= runFor;
+        t += runFor;
+
+        if (remaining == 0) {
+            long long ta = t - arrival[best];
+            lat.ta.record(ta);
+            lat.wait.record(ta - burst[best]);
+            finished++;
+        } else {
+            ready.push(ReadyEntry(remaining, best));
+        }
+    }
+
+    return lat.stats();
+}
+
+// A time slice can only run once every arrival up to its end is known,
+// since those arrivals queue ahead of the preempted job. Jobs that have been
+// added but not reached yet wait in `pending`.
+class RoundRobinSim {
+public:
+    explicit RoundRobinSim(int q) : quantum(q) {}
+
+    void add(long long arrival, long long burst) {
+        pending.push_back(Job{arrival, burst, burst, -1});
+        lastArrival = arrival;
+        advance(false);
+    }
+
+    Stats finish() {
+        advance(true);
+        return lat.stats();
+    }
+
+private:
+    struct Job {
+        long long arrival;
+        long long burst;
+        long long remaining;
+        long long firstStart;
+    };
+
+    void advance(bool final) {
+        while (true) {
+            if (rq.empty()) {
+                if (pending.empty()) return;
+                // jump to next arrival
+                t = pending.front().arrival;
+                rq.push_back(pending.front());
+                pending.pop_front();
+            }
+
+            Job& front = rq.front();
+            long long slice = min((long long)quantum, front.remaining);
+            long long endTime = t + slice;
+
+            // A later add() could still arrive at or before endTime.
+            if (!final && lastArrival <= endTime) return;
+
+            Job p = front;
+            rq.pop_front();
+
+            if (p.firstStart == -1) p.firstStart = t;
+
+            // IMPORTANT RULE:
+            // Add any processes that arrive during this slice BEFORE re-adding p.
+            while (!pending.empty() && pending.front().arrival <= endTime) {
+                rq.push_back(pending.front());
+                pending.pop_front();
+            }
+
+            p.remaining -= slice;
+            t = endTime;
+
+            if (p.remaining == 0) {
+                long long resp = p.firstStart - p.arrival;
+                long long ta = t - p.arrival;
+                long long wait = ta - p.burst;
+
+                lat.record(resp, ta, wait);
+            } else {
+                rq.push_back(p);
+            }
+        }
+    }
+
+    int quantum;
+    deque<Job> rq;
+    deque<Job> pending;
+    long long t = 0;
+    long long lastArrival = 0;
+    LatencyRecorder lat;
+};
+
+Stats runRR(const ProcessTable& procs, int quantum) {
+    RoundRobinSim sim(quantum);
+    for (int i = 0; i < procs.size(); i++) sim.add(procs.arrival[i], procs.burst[i]);
+    return sim.finish();
+}
+
+struct MlfqConfig {
+    vector<long long> quanta;  // one per level, top level first; empty disables MLFQ
+    long long boost;           // 0 never boosts
+};
+
+// Multi-level feedback queue with the usual rules: new jobs enter the top
+// level, a job that uses up its level's quantum drops one level, a higher
+// level always preempts a lower one, and every `boost` ticks all jobs go
+// back to the top. Each level is round robin; a preempted job keeps the
+// rest of its quantum and resumes at the head of its level. With one level
+// and no boost this is exactly runRR.
+//
+// A boost costs O(levels), not O(jobs): the lower levels are spliced onto
+// the top level as whole segments, and a job's used quantum is reset when
+// it is next picked if it was queued before the boost.
+Stats runMLFQ(const ProcessTable& procs, const MlfqConfig& cfg) {
+    struct Job {
+        int idx;
+        long long remaining;
+        long long used;   // of the current level's quantum
+        long long epoch;  // boosts seen when last picked
+    };
+    typedef deque<Job> Level;
+
+    int n = procs.size();
+    int levels = (int)cfg.quanta.size();
+    const vector<long long>& arrival = procs.arrival;
+    const vector<long long>& burst = procs.burst;
+    const vector<int>& order = procs.order;
+
+    deque<Level> top;            // top level, as a run of segments
+    vector<Level> lower(levels); // lower[0] is unused
+
+    LatencyRecorder lat;
+    long long t = 0;
+    long long epoch = 0;
+    long long nextBoost = cfg.boost > 0 ? cfg.boost : LLONG_MAX;
+    int finished = 0;
+    int next = 0;
+
+    auto pushBack = [&](int level, const Job& job) {
+        if (level > 0) {
+            lower[level].push_back(job);
+            return;
+        }
+        if (top.empty()) top.emplace_back();
+        top.back().push_back(job);
+    };
+    auto pushFront = [&](int level, const Job& job) {
+        if (level > 0) {
+            lower[level].push_front(job);
+            return;
+        }
+        if (top.empty()) top.emplace_front();
+        top.front().push_front(job);
+    };
+    auto admit = [&]() {
+        while (next < n && arrival[order[next]] <= t) {
+            int i = order[next++];
+            pushBack(0, Job{i, burst[i], 0, epoch});
+        }
+    };
+
+    while (finished < n) {
+        admit();
+
+        if (t >= nextBoost) {
+            epoch++;
+            for (int l = 1; l < levels; l++) {
+                if (lower[l].empty()) continue;
+                top.push_back(move(lower[l]));
+                lower[l].clear();
+            }
+            nextBoost += ((t - nextBoost) / cfg.boost + 1) * cfg.boost;
+        }
+
+        while (!top.empty() && top.front().empty()) top.pop_front();
+        int level = top.empty() ? -1 : 0;
+        for (int l = 1; level < 0 && l < levels; l++) {
+            if (!lower[l].empty()) level = l;
+        }
+
+        if (level < 0) {
+            // jump to next arrival
+            t = arrival[order[next]];
+            continue;
+        }
+
+        Level& q = level == 0 ? top.front() : lower[level];
+        Job p = q.front();
+        q.pop_front();
+
+        if (p.epoch != epoch) {
+            p.used = 0;
+            p.epoch = epoch;
+        }
+        // Slices are never empty, so a full burst means a first run.
+        if (p.remaining == burst[p.idx]) lat.resp.record(t - arrival[p.idx]);
+
+        // Run to the end of the quantum, or until an arrival (which enters
+        // the top level) or a boost takes the CPU away.
+        long long runFor = min(p.remaining, cfg.quanta[level] - p.used);
+        if (level > 0 && next < n) runFor = min(runFor, arrival[order[next]] - t);
+        runFor = min(runFor, nextBoost - t);
+
+        t += runFor;
+        p.remaining -= runFor;
+        p.used += runFor;
+
+        // As in RR, arrivals during the slice queue ahead of p.
+        admit();
+
+        if (p.remaining == 0) {
+            long long ta = t - arrival[p.idx];
+            lat.ta.record(ta);
+            lat.wait.record(ta - burst[p.idx]);
+            finished++;
+        } else if (p.used == cfg.quanta[level]) {
+            p.used = 0;
+            pushBack(min(level + 1, levels - 1), p);
+        } else {
+            pushFront(level, p);
+        }
+    }
+
+    return lat.stats();
+}
+
+struct CfsConfig {
+    long long latency;         // period in which every runnable job should run; 0 disables CFS
+    long long minGranularity;  // shortest slice
+};
+
+// CFS-style fair scheduler. Jobs all have the same weight, so a job's
+// virtual runtime is simply the CPU time it has had. The runnable job with
+// the smallest vruntime runs next for max(latency / runnable, minGranularity)
+// ticks. New jobs start at min_vruntime, so they neither starve the queue
+// nor get starved. The run queue is a std::set (a red-black tree). Wakeup
+// preemption is not modelled; an arrival waits for the current slice.
+Stats runCFS(const ProcessTable& procs, const CfsConfig& cfg) {
+    struct Entity {
+        long long vruntime;
+        int idx;
+        long long remaining;
+
+        bool operator<(const Entity& o) const {
+            return vruntime != o.vruntime ? vruntime < o.vruntime : idx < o.idx;
+        }
+    };
+
+    int n = procs.size();
+    const vector<long long>& arrival = procs.arrival;
+    const vector<long long>& burst = procs.burst;
+    const vector<int>& order = procs.order;
+
+    set<Entity> tree;
+    LatencyRecorder lat;
+    long long t = 0;
+    long long minVruntime = 0;
+    int finished = 0;
+    int next = 0;
+
+    while (finished < n) {
+        while (next < n && arrival[order[next]] <= t) {
+            int i = order[next++];
+            tree.insert(Entity{minVruntime, i, burst[i]});
+        }
+
+        if (tree.empty()) {
+            // jump to next arrival
+            t = arrival[order[next]];
+            continue;
+        }
+
+        Entity e = *tree.begin();
+        tree.erase(tree.begin());
+
+        if (e.remaining == burst[e.idx]) lat.resp.record(t - arrival[e.idx]);
+
+        long long slice = max(cfg.latency / (long long)(tree.size() + 1), cfg.minGranularity);
+        long long runFor = min(slice, e.remaining);
+
+        t += runFor;
+        e.vruntime += runFor;
+        e.remaining -= runFor;
+
+        if (e.remaining == 0) {
+            long long ta = t - arrival[e.idx];
+            lat.ta.record(ta);
+            lat.wait.record(ta - burst[e.idx]);
+            finished++;
+        } else {
+            tree.insert(e);
+        }
+
+        // min_vruntime only moves forward
+        if (!tree.empty()) minVruntime = max(minVruntime, tree.begin()->vruntime);
+    }
+
+    return lat.stats();
+}
+
+static const size_t READ_BUF_SIZE = 1 << 20;
+static const char TRACE_MAGIC[8] = {'P', '4', 'T', 'R', 'A', 'C', 'E', '1'};
+
+// Job traces come in two forms, told apart by the first 8 bytes:
+//   text:   whitespace separated "arrival burst" pairs
+//   binary: TRACE_MAGIC, then per job the zigzag varint of the arrival delta
+//           from the previous job followed by the varint burst (LEB128)
+// Regular files are mapped whole; pipes go through one READ_BUF_SIZE buffer,
+// so the reader's memory does not grow with the trace.
+class TraceReader {
+public:
+    ~TraceReader() {
+        if (map) munmap(map, mapLen);
+        if (fd > 0) close(fd);
+    }
+
+    bool open(const char* path) {
+        if (path == nullptr || strcmp(path, "-") == 0) {
+            fd = STDIN_FILENO;
+        } else {
+            fd = ::open(path, O_RDONLY);
+            if (fd < 0) return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                madvise(m, st.st_size, MADV_SEQUENTIAL);
+                map = static_cast<char*>(m);
+                mapLen = st.st_size;
+                pos = map;
+                end = map + mapLen;
+                eof = true;
+            }
+        }
+        if (!map) {
+            buf.reset(new char[READ_BUF_SIZE]);
+        }
+
+        binary = true;
+        for (size_t i = 0; i < sizeof(TRACE_MAGIC) && binary; i++) {
+            binary = peek() == (unsigned char)TRACE_MAGIC[i];
+            if (binary) pos++;
+        }
+        // Bytes matched here are not rewound; a text trace never starts
+        // with 'P', so at most one byte of a bad trace is skipped.
+        return true;
+    }
+
+    // False at end of input; bad() tells a malformed trace from a clean end.
+    bool next(long long& arrival, long long& burst) {
+        return binary ? nextBinary(arrival, burst) : nextText(arrival, burst);
+    }
+
+    bool bad() const { return malformed; }
+
+private:
+    int peek() {
+        if (pos == end && !refill()) return -1;
+        return (unsigned char)*pos;
+    }
+
+    bool refill() {
+        if (eof) return false;
+        ssize_t n;
+        do {
+            n = read(fd, buf.get(), READ_BUF_SIZE);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            eof = true;
+            return false;
+        }
+        pos = buf.get();
+        end = pos + n;
+        return true;
+    }
+
+    bool readNumber(long long& v) {
+        int c;
+        while ((c = peek()) == ' ' || c == '\t' || c == '\r' || c == '\n') pos++;
+        if (c < 0) return false;
+
+        bool neg = c == '-';
+        if (neg) pos++;
+
+        v = 0;
+        int digits = 0;
+        while ((c = peek()) >= '0' && c <= '9') {
+            if (v > (LLONG_MAX - (c - '0')) / 10) {
+                malformed = true;
+                return false;
+            }
+            v = v * 10 + (c - '0');
+            digits++;
+            pos++;
+        }
+        if (digits == 0 || (c >= 0 && c != ' ' && c != '\t' && c != '\r' && c != '\n')) {
+            malformed = true;
+            return false;
+        }
+        if (neg) v = -v;
+        return true;
+    }
+
+    bool nextText(long long& arrival, long long& burst) {
+        if (!readNumber(arrival)) return false;
+        if (!readNumber(burst)) {
+            malformed = true;  // odd number of values
+            return false;
+        }
+        return true;
+    }
+
+    bool readVarint(unsigned long long& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int c = peek();
+            if (c < 0) return false;
+            pos++;
+            v |= (unsigned long long)(c & 0x7f) << shift;
+            if (!(c & 0x80)) return true;
+        }
+        malformed = true;
+        return false;
+    }
+
+    bool nextBinary(long long& arrival, long long& burst) {
+        unsigned long long delta, b;
+        if (!readVarint(delta)) return false;
+        if (!readVarint(b)) {
+            malformed = true;  // truncated record
+            return false;
+        }
+        prevArrival += (long long)(delta >> 1) ^ -(long long)(delta & 1);
+        arrival = prevArrival;
+        burst = (long long)b;
+        return true;
+    }
+
+    int fd = -1;
+    char* map = nullptr;
+    size_t mapLen = 0;
+    unique_ptr<char[]> buf;
+    const char* pos = nullptr;
+    const char* end = nullptr;
+    bool eof = false;
+    bool binary = false;
+    bool malformed = false;
+    long long prevArrival = 0;
+};
+
+// Writes the binary trace format described above TraceReader.
+class TraceWriter {
+public:
+    explicit TraceWriter(int outFd) : fd(outFd), buf(new char[READ_BUF_SIZE]) {
+        memcpy(buf.get(), TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        len = sizeof(TRACE_MAGIC);
+    }
+
+    void add(long long arrival, long long burst) {
+        if (READ_BUF_SIZE - len < 20) flush();
+        long long delta = arrival - prevArrival;
+        prevArrival = arrival;
+        putVarint(((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+        putVarint((unsigned long long)burst);
+    }
+
+    bool flush() {
+        const char* p = buf.get();
+        while (len > 0 && ok) {
+            ssize_t n = write(fd, p, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+                break;
+            }
+            p += n;
+            len -= n;
+        }
+        len = 0;
+        return ok;
+    }
+
+private:
+    void putVarint(unsigned long long v) {
+        while (v >= 0x80) {
+            buf[len++] = (char)(v | 0x80);
+            v >>= 7;
+        }
+        buf[len++] = (char)v;
+    }
+
+    int fd;
+    unique_ptr<char[]> buf;
+    size_t len = 0;
+    long long prevArrival = 0;
+    bool ok = true;
+};
+
+static const int MAX_WORKERS = 256;
+
+// Listed in report order.
+enum class Policy { FCFS, SJF, SRTF, RR, MLFQ, CFS };
+
+enum class Balance { GLOBAL, STEAL };
+
+struct SmpConfig {
+    int cpus;  // 0 selects the single-CPU simulators above
+    Balance balance;
+    long long migrationCost;
+};
+
+// Event-driven multi-CPU simulation shared by all four policies. A policy
+// only picks the ready-queue key (arrival rank, burst, remaining time or
+// enqueue order) and whether an arrival may preempt (SRTF). Run queues are
+// either one global heap or a heap per CPU, with idle CPUs stealing the best
+// job from the longest queue. A job that resumes on a CPU other than the one
+// it last ran on first spends migrationCost ticks there.
+//
+// Everything due at the same instant is applied before any dispatch
+// decision: arrivals, then slice ends (so RR requeues behind new arrivals),
+// then dispatch, preemption and stealing. With one CPU this reproduces the
+// single-CPU simulators. Each event costs O(log n + log cpus).
+class SmpSim {
+public:
+    SmpSim(const ProcessTable& p, Policy pol, int q, const SmpConfig& cfg)
+        : procs(p), policy(pol), quantum(q), config(cfg), cpus(cfg.cpus) {
+        if (config.balance == Balance::STEAL) {
+            for (int c = 0; c < config.cpus; c++) loads.insert(make_pair(0, c));
+        }
+        for (int c = 0; c < config.cpus; c++) idle.insert(c);
+        trackVictims = policy == Policy::SRTF && config.balance == Balance::GLOBAL;
+    }
+
+    Stats run() {
+        int n = procs.size();
+        const vector<long long>& arrival = procs.arrival;
+        const vector<int>& order = procs.order;
+        int next = 0;
+
+        while (finished < n) {
+            long long t = events.empty() ? LLONG_MAX : events.begin()->first;
+            if (next < n) t = min(t, arrival[order[next]]);
+
+            while (next < n && arrival[order[next]] <= t) {
+                admit(order[next], next);
+                next++;
+            }
+            while (!events.empty() && events.begin()->first == t) {
+                int c = events.begin()->second;
+                events.erase(events.begin());
+                endSlice(c, t);
+            }
+            schedule(t);
+        }
+        return lat.stats();
+    }
+
+private:
+    struct ReadyJob {
+        long long key;
+        int idx;
+        long long remaining;
+        int lastCpu;  // -1 until the job first runs
+
+        bool operator>(const ReadyJob& o) const {
+            return key != o.key ? key > o.key : idx > o.idx;
+        }
+    };
+    typedef priority_queue<ReadyJob, vector<ReadyJob>, greater<ReadyJob>> JobHeap;
+
+    struct Cpu {
+        int job = -1;
+        long long remaining = 0;  // job's remaining time when dispatched
+        long long workStart = 0;  // dispatch time plus any migration cost
+        long long end = 0;
+        JobHeap queue;
+        bool dirty = false;
+    };
+
+    long long keyFor(int idx, int rank, long long remaining) {
+        switch (policy) {
+        case Policy::FCFS: return rank;
+        case Policy::SJF: return procs.burst[idx];
+        case Policy::SRTF: return remaining;
+        case Policy::RR: break;
+        case Policy::MLFQ:
+        case Policy::CFS: break;  // single-CPU only; main rejects them with -c
+        }
+        return enqueued++;
+    }
+
+    JobHeap& queueOf(int c) {
+        return config.balance == Balance::GLOBAL ? globalQueue : cpus[c].queue;
+    }
+
+    void push(int c, const ReadyJob& job) {
+        JobHeap& q = queueOf(c);
+        if (config.balance == Balance::STEAL) {
+            loads.erase(make_pair((int)q.size(), c));
+            loads.insert(make_pair((int)q.size() + 1, c));
+            markDirty(c);
+        }
+        q.push(job);
+    }
+
+    ReadyJob pop(int c) {
+        JobHeap& q = queueOf(c);
+        if (config.balance == Balance::STEAL) {
+            loads.erase(make_pair((int)q.size(), c));
+            loads.insert(make_pair((int)q.size() - 1, c));
+        }
+        ReadyJob job = q.top();
+        q.pop();
+        return job;
+    }
+
+    void markDirty(int c) {
+        if (!cpus[c].dirty) {
+            cpus[c].dirty = true;
+            dirty.push_back(c);
+        }
+    }
+
+    void admit(int idx, int rank) {
+        long long b = procs.burst[idx];
+        int c = config.balance == Balance::STEAL ? placed++ % config.cpus : 0;
+        push(c, ReadyJob{keyFor(idx, rank, b), idx, b, -1});
+    }
+
+    // Takes the running job off CPU c at time t and returns it to the ready
+    // queue, or records it if it has finished.
+    void endSlice(int c, long long t) {
+        Cpu& cpu = cpus[c];
+        int idx = cpu.job;
+        long long rem = cpu.remaining - max(0LL, t - cpu.workStart);
+
+        if (trackVictims) untrack(c);
+        cpu.job = -1;
+        idle.insert(c);
+        markDirty(c);
+
+        if (rem == 0) {
+            long long ta = t - procs.arrival[idx];
+            lat.ta.record(ta);
+            lat.wait.record(ta - procs.burst[idx]);
+            finished++;
+        } else {
+            push(c, ReadyJob{keyFor(idx, 0, rem), idx, rem, c});
+        }
+    }
+
+    void preempt(int c, long long t) {
+        events.erase(make_pair(cpus[c].end, c));
+        endSlice(c, t);
+    }
+
+    void dispatch(int c, const ReadyJob& job, long long t) {
+        Cpu& cpu = cpus[c];
+        long long cost = 0;
+        if (job.lastCpu < 0) {
+            lat.resp.record(t - procs.arrival[job.idx]);
+        } else if (job.lastCpu != c) {
+            cost = config.migrationCost;
+        }
+
+        long long slice = job.remaining;
+        if (policy == Policy::RR) slice = min(slice, (long long)quantum);
+
+        cpu.job = job.idx;
+        cpu.remaining = job.remaining;
+        cpu.workStart = t + cost;
+        cpu.end = cpu.workStart + slice;
+        idle.erase(c);
+        events.insert(make_pair(cpu.end, c));
+        if (trackVictims) track(c, t);
+    }
+
+    // Global SRTF preempts the busy CPU whose job has the most work left.
+    // Once a job is doing real work that is end - t, so those CPUs rank by
+    // slice end; one still paying migration cost has all of its remaining
+    // time left until work starts, so it ranks by that instead.
+    void track(int c, long long t) {
+        const Cpu& cpu = cpus[c];
+        if (cpu.workStart > t) {
+            migrating.insert(make_tuple(cpu.remaining, cpu.end, c));
+            settling.insert(make_pair(cpu.workStart, c));
+        } else {
+            working.insert(make_pair(cpu.end, c));
+        }
+    }
+
+    void untrack(int c) {
+        const Cpu& cpu = cpus[c];
+        if (settling.erase(make_pair(cpu.workStart, c))) {
+            migrating.erase(make_tuple(cpu.remaining, cpu.end, c));
+        } else {
+            working.erase(make_pair(cpu.end, c));
+        }
+    }
+
+    // True if `job` should displace what CPU c is running (SRTF only).
+    bool beats(const ReadyJob& job, int c, long long t) const {
+        const Cpu& cpu = cpus[c];
+        long long rem = cpu.remaining - max(0LL, t - cpu.workStart);
+        return job.key != rem ? job.key < rem : job.idx < cpu.job;
+    }
+
+    // The busy CPU whose job has the most work left, ties going to the later
+    // slice end and then the higher CPU.
+    int preemptVictim(long long t) {
+        while (!settling.empty() && settling.begin()->first <= t) {
+            int c = settling.begin()->second;
+            settling.erase(settling.begin());
+            migrating.erase(make_tuple(cpus[c].remaining, cpus[c].end, c));
+            working.insert(make_pair(cpus[c].end, c));
+        }
+
+        tuple<long long, long long, int> best(-1, -1, -1);
+        if (!working.empty()) {
+            const pair<long long, int>& w = *working.rbegin();
+            best = make_tuple(w.first - t, w.first, w.second);
+        }
+        if (!migrating.empty()) best = max(best, *migrating.rbegin());
+        return get<2>(best);
+    }
+
+    void schedule(long long t) {
+        if (config.balance == Balance::GLOBAL) {
+            while (!idle.empty() && !globalQueue.empty()) {
+                ReadyJob job = pop(0);
+                // keep the job where it last ran if that CPU is free
+                int c = idle.count(job.lastCpu) ? job.lastCpu : *idle.begin();
+                dispatch(c, job, t);
+            }
+            while (policy == Policy::SRTF && !globalQueue.empty() && !events.empty()) {
+                int c = preemptVictim(t);
+                if (!beats(globalQueue.top(), c, t)) break;
+                ReadyJob job = pop(0);
+                preempt(c, t);
+                dispatch(c, job, t);
+            }
+            for (int c : dirty) cpus[c].dirty = false;
+            dirty.clear();
+            return;
+        }
+
+        for (size_t i = 0; i < dirty.size(); i++) {
+            int c = dirty[i];
+            Cpu& cpu = cpus[c];
+            cpu.dirty = false;
+            if (cpu.queue.empty()) continue;
+            if (cpu.job < 0) {
+                dispatch(c, pop(c), t);
+            } else if (policy == Policy::SRTF && beats(cpu.queue.top(), c, t)) {
+                ReadyJob job = pop(c);
+                preempt(c, t);
+                dispatch(c, job, t);
+            }
+        }
+        dirty.clear();
+
+        // Idle CPUs have empty queues here; let them steal.
+        while (!idle.empty() && loads.rbegin()->first > 0) {
+            int victim = loads.rbegin()->second;
+            int c = *idle.begin();
+            dispatch(c, pop(victim), t);
+        }
+    }
+
+    const ProcessTable& procs;
+    Policy policy;
+    int quantum;
+    SmpConfig config;
+
+    vector<Cpu> cpus;
+    JobHeap globalQueue;
+    set<pair<long long, int>> events;  // (slice end, cpu) for busy CPUs
+    bool trackVictims = false;         // global SRTF only
+    set<pair<long long, int>> working;  // (slice end, cpu), work under way
+    set<tuple<long long, long long, int>> migrating;  // (remaining, slice end, cpu)
+    set<pair<long long, int>> settling;  // (work start, cpu) for migrating CPUs
+    set<int> idle;
+    set<pair<int, int>> loads;  // (queue length, cpu), STEAL only
+    vector<int> dirty;
+    LatencyRecorder lat;
+    long long enqueued = 0;
+    long long placed = 0;
+    int finished = 0;
+};
+
+// One policy run over the shared trace. The trace is only read, so any
+// number of tasks can run on it at once.
+struct EvalTask {
+    Policy policy;
+    int quantum;
+    Stats result;
+};
+
+struct RunConfig {
+    SmpConfig smp;
+    MlfqConfig mlfq;
+    CfsConfig cfs;
+};
+
+struct EvalPool {
+    const ProcessTable* procs;
+    const RunConfig* config;
+    vector<EvalTask>* tasks;
+    atomic<size_t> next;
+};
+
+static void runTask(const ProcessTable& procs, const RunConfig& config, EvalTask& task) {
+    if (config.smp.cpus > 0) {
+        task.result = SmpSim(procs, task.policy, task.quantum, config.smp).run();
+        return;
+    }
+    switch (task.policy) {
+    case Policy::FCFS: task.result = runFCFS(procs); break;
+    case Policy::SJF: task.result = runSJF(procs); break;
+    case Policy::SRTF: task.result = runSRTF(procs); break;
+    case Policy::RR: task.result = runRR(procs, task.quantum); break;
+    case Policy::MLFQ: task.result = runMLFQ(procs, config.mlfq); break;
+    case Policy::CFS: task.result = runCFS(procs, config.cfs); break;
+    }
+}
+
+static void* evalWorker(void* arg) {
+    EvalPool* pool = static_cast<EvalPool*>(arg);
+    vector<EvalTask>& tasks = *pool->tasks;
+    size_t i;
+    while ((i = pool->next.fetch_add(1, memory_order_relaxed)) < tasks.size()) {
+        runTask(*pool->procs, *pool->config, tasks[i]);
+    }
+    return nullptr;
+}
+
+// Runs every task, spreading them over up to nthreads threads. Workers claim
+// tasks one at a time, so list the expensive ones first.
+static void evaluate(const ProcessTable& procs, const RunConfig& config,
+                     vector<EvalTask>& tasks, int nthreads) {
+    EvalPool pool;
+    pool.procs = &procs;
+    pool.config = &config;
+    pool.tasks = &tasks;
+    pool.next = 0;
+
+    if (nthreads > (int)tasks.size()) nthreads = (int)tasks.size();
+
+    vector<pthread_t> threads;
+    for (int i = 1; i < nthreads; i++) {
+        pthread_t th;
+        if (pthread_create(&th, nullptr, evalWorker, &pool) != 0) break;
+        threads.push_back(th);
+    }
+    // The calling thread works too, so a failed pthread_create only costs
+    // parallelism.
+    evalWorker(&pool);
+    for (pthread_t th : threads) pthread_join(th, nullptr);
+}
+
+static int defaultThreads() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_WORKERS) return MAX_WORKERS;
+    return (int)n;
+}
+
+static void printStats(const Stats& s) {
+    cout << fixed << setprecision(2);
+    cout << "Avg. Resp.:" << s.avgResp
+         << ", Avg. T.A.:" << s.avgTA
+         << ", Avg. Wait:" << s.avgWait << "\n";
+}
+
+static void printTableRow(const string& name, const Stats& s) {
+    cout << left << setw(10) << name << right
+         << setw(16) << s.avgResp
+         << setw(16) << s.avgTA
+         << setw(16) << s.avgWait << "\n";
+}
+
+enum class OutputFormat { TEXT, CSV, JSON };
+
+struct ReportRow {
+    string policy;
+    int quantum;  // RR only; 0 for the other policies
+    Stats stats;
+};
+
+static void printCsvMetric(double avg, const Percentiles& p) {
+    cout << "," << avg << "," << p.p50 << "," << p.p90 << "," << p.p99
+         << "," << p.p999 << "," << p.max;
+}
+
+static void printCsv(const vector<ReportRow>& rows) {
+    cout << fixed << setprecision(2);
+    cout << "policy,quantum";
+    for (const char* m : {"resp", "ta", "wait"}) {
+        for (const char* f : {"avg", "p50", "p90", "p99", "p999", "max"}) cout << "," << m << "_" << f;
+    }
+    cout << "\n";
+    for (const ReportRow& r : rows) {
+        cout << r.policy << ",";
+        if (r.quantum > 0) cout << r.quantum;
+        printCsvMetric(r.stats.avgResp, r.stats.resp);
+        printCsvMetric(r.stats.avgTA, r.stats.ta);
+        printCsvMetric(r.stats.avgWait, r.stats.wait);
+        cout << "\n";
+    }
+}
+
+static void printJsonMetric(const char* name, double avg, const Percentiles& p) {
+    cout << "\"" << name << "\": {\"avg\": " << avg << ", \"p50\": " << p.p50
+         << ", \"p90\": " << p.p90 << ", \"p99\": " << p.p99
+         << ", \"p999\": " << p.p999 << ", \"max\": " << p.max << "}";
+}
+
+static void printJson(const vector<ReportRow>& rows) {
+    cout << fixed << setprecision(2);
+    cout << "[\n";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const ReportRow& r = rows[i];
+        cout << "  {\"policy\": \"" << r.policy << "\", ";
+        if (r.quantum > 0) cout << "\"quantum\": " << r.quantum << ", ";
+        printJsonMetric("response", r.stats.avgResp, r.stats.resp);
+        cout << ", ";
+        printJsonMetric("turnaround", r.stats.avgTA, r.stats.ta);
+        cout << ", ";
+        printJsonMetric("wait", r.stats.avgWait, r.stats.wait);
+        cout << "}" << (i + 1 < rows.size() ? "," : "") << "\n";
+    }
+    cout << "]\n";
+}
+
+static string joinQuanta(const vector<long long>& quanta) {
+    string s;
+    for (size_t i = 0; i < quanta.size(); i++) s += (i ? "," : "") + to_string(quanta[i]);
+    return s;
+}
+
+// Section heading for the text report.
+static string policyTitle(const EvalTask& task, const RunConfig& config) {
+    switch (task.policy) {
+    case Policy::FCFS: return "First Come, First Served";
+    case Policy::SJF: return "Shortest Job First";
+    case Policy::SRTF: return "Shortest Remaining Time First";
+    case Policy::RR: return "Round Robin with Time Quantum of " + to_string(task.quantum);
+    case Policy::MLFQ: {
+        string title = "Multi-Level Feedback Queue with Quanta of " + joinQuanta(config.mlfq.quanta);
+        if (config.mlfq.boost > 0) title += " and Boost Every " + to_string(config.mlfq.boost);
+        return title;
+    }
+    case Policy::CFS:
+        return "Completely Fair Scheduler with Latency of " + to_string(config.cfs.latency) +
+               " and Minimum Granularity of " + to_string(config.cfs.minGranularity);
+    }
+    return "";
+}
+
+// Short name for tables, CSV and JSON.
+static string policyName(Policy policy) {
+    switch (policy) {
+    case Policy::FCFS: return "FCFS";
+    case Policy::SJF: return "SJF";
+    case Policy::SRTF: return "SRTF";
+    case Policy::RR: return "RR";
+    case Policy::MLFQ: return "MLFQ";
+    case Policy::CFS: return "CFS";
+    }
+    return "";
+}
+
+// Parses "q1,q2,...[:boost]" for MLFQ.
+static bool parseMlfq(const string& spec, MlfqConfig& cfg) {
+    cfg.quanta.clear();
+    cfg.boost = 0;
+    const char* p = spec.c_str();
+    char* end;
+    while (true) {
+        long long q = strtoll(p, &end, 10);
+        if (end == p || q < 1) return false;
+        cfg.quanta.push_back(q);
+        p = end;
+        if (*p != ',') break;
+        p++;
+    }
+    if (*p == ':') {
+        cfg.boost = strtoll(p + 1, &end, 10);
+        if (end == p + 1 || cfg.boost < 0) return false;
+        p = end;
+    }
+    return *p == '\0';
+}
+
+// Parses "latency[:min_granularity]" for CFS.
+static bool parseCfs(const string& spec, CfsConfig& cfg) {
+    cfg.minGranularity = 1;
+    char colon;
+    int fields = sscanf(spec.c_str(), "%lld%c%lld", &cfg.latency, &colon, &cfg.minGranularity);
+    if (fields != 1 && (fields != 3 || colon != ':')) return false;
+    return cfg.latency >= 1 && cfg.minGranularity >= 1;
+}
+
+// Parses "lo-hi" or "lo-hi:step" for the quantum sweep.
+static bool parseSweep(const string& spec, int& lo, int& hi, int& step) {
+    char dash, colon;
+    size_t used = 0;
+    step = 1;
+    if (sscanf(spec.c_str(), "%d%c%d%zn", &lo, &dash, &hi, &used) != 3 || dash != '-') return false;
+    if (used < spec.size() &&
+        (sscanf(spec.c_str() + used, "%c%d", &colon, &step) != 2 || colon != ':')) return false;
+    return lo >= 1 && hi >= lo && step >= 1;
+}
+
+// Synthetic traces for benchmarking: Poisson arrivals (exponential gaps)
+// and bounded Pareto bursts, with gaps scaled so the offered load is
+// BENCH_LOAD.
+static const double BENCH_LOAD = 0.9;
+static const double BENCH_ALPHA = 1.5;  // Pareto shape: heavy tail, finite mean
+static const double BENCH_MIN_BURST = 1.0;
+static const double BENCH_MAX_BURST = 1e6;
+static const int BENCH_MAX_EXP = 9;
+
+static void generateTrace(ProcessTable& procs, long long n, unsigned long long seed) {
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    double meanBurst = BENCH_ALPHA * BENCH_MIN_BURST / (BENCH_ALPHA - 1);
+    exponential_distribution<double> gap(BENCH_LOAD / meanBurst);
+
+    procs.arrival.reserve(n);
+    procs.burst.reserve(n);
+    double t = 0;
+    for (long long i = 0; i < n; i++) {
+        t += gap(rng);
+        double b = BENCH_MIN_BURST / pow(1.0 - unit(rng), 1.0 / BENCH_ALPHA);
+        procs.add((long long)t, max(1LL, llround(min(b, BENCH_MAX_BURST))));
+    }
+}
+
+// Starts a new peak-RSS window. Linux resets VmHWM when "5" is written to
+// clear_refs; elsewhere the peak stays cumulative for the process.
+static bool resetPeakRss() {
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return false;
+    bool ok = fputs("5", f) >= 0;
+    return fclose(f) == 0 && ok;
+}
+
+static long peakRssKb() {
+    FILE* f = fopen("/proc/self/status", "r");
+    if (f) {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+        }
+        fclose(f);
+        if (kb >= 0) return kb;
+    }
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+// Times each enabled policy on synthetic traces of 10^lo .. 10^hi jobs.
+// Policies run one at a time on this thread so the timings don't interfere.
+static void runBenchmark(int lo, int hi, int step, int quantum, const RunConfig& config) {
+    bool perPolicyRss = resetPeakRss();
+
+    cout << fixed << setprecision(2);
+    cout << right << setw(12) << "Jobs" << "  " << left << setw(8) << "Policy" << right
+         << setw(12) << "ms" << setw(10) << "ns/job" << setw(14) << "Peak RSS MB"
+         << setw(16) << "Avg. Wait" << "\n";
+
+    for (int e = lo; e <= hi; e += step) {
+        long long n = 1;
+        for (int i = 0; i < e; i++) n *= 10;
+
+        ProcessTable procs;
+        generateTrace(procs, n, e);
+        procs.seal();
+
+        vector<EvalTask> tasks;
+        tasks.push_back(EvalTask{Policy::FCFS, 0, Stats()});
+        tasks.push_back(EvalTask{Policy::SJF, 0, Stats()});
+        tasks.push_back(EvalTask{Policy::SRTF, 0, Stats()});
+        tasks.push_back(EvalTask{Policy::RR, quantum, Stats()});
+        if (!config.mlfq.quanta.empty()) tasks.push_back(EvalTask{Policy::MLFQ, 0, Stats()});
+        if (config.cfs.latency > 0) tasks.push_back(EvalTask{Policy::CFS, 0, Stats()});
+
+        for (EvalTask& task : tasks) {
+            if (perPolicyRss) resetPeakRss();
+            auto start = chrono::steady_clock::now();
+            runTask(procs, config, task);
+            auto end = chrono::steady_clock::now();
+            double ns = chrono::duration<double, nano>(end - start).count();
+
+            cout << setw(12) << n << "  " << left << setw(8) << policyName(task.policy) << right
+                 << setw(12) << ns / 1e6 << setw(10) << ns / n
+                 << setw(14) << peakRssKb() / 1024.0
+                 << setw(16) << task.result.avgWait << "\n" << flush;
+        }
+    }
+
+    if (!perPolicyRss) cout << "(peak RSS is cumulative: /proc/self/clear_refs unavailable)\n";
+}
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [-f trace] [-s] [-w out.bin] [-j threads] [-r lo-hi[:step]] [-o format]\n"
+         << "       [-c cpus [-b global|steal] [-m cost]] [-M q1,q2,...[:boost]] [-F latency[:min_gran]]\n"
+         << "       [quantum] < trace\n"
+         << "  -f trace    read the trace from a file instead of stdin\n"
+         << "  -s          stream: run FCFS and RR in one pass without storing the trace\n"
+         << "  -w out.bin  convert the trace to the binary format and exit\n"
+         << "  -j threads  run the policies on this many threads (default: all cores)\n"
+         << "  -r lo-hi    sweep the RR quantum over lo..hi and print a comparison table\n"
+         << "  -o format   text (default), csv or json; csv and json add latency percentiles\n"
+         << "  -c cpus     simulate this many CPUs (all policies)\n"
+         << "  -b balance  with -c: one global run queue, or per-CPU queues with work stealing (default)\n"
+         << "  -m cost     with -c: ticks a job loses when it resumes on a different CPU (default 0)\n"
+         << "  -M spec     also run MLFQ with these per-level quanta and boost interval\n"
+         << "  -F spec     also run a CFS-style scheduler with this target latency and minimum slice\n"
+         << "  -g n        write a synthetic n-job trace (Poisson arrivals, Pareto bursts) and exit\n"
+         << "  -B lo-hi[:step]  benchmark each policy on synthetic traces of 10^lo..10^hi jobs\n"
+         << "              (10^8 jobs needs about 2.5 GB)\n";
+}
+
+int main(int argc, char* argv[]) {
+    int quantum = 100;
+    const char* path = nullptr;
+    const char* convertTo = nullptr;
+    bool stream = false;
+    int nthreads = defaultThreads();
+    bool sweep = false;
+    int sweepLo = 0, sweepHi = 0, sweepStep = 1;
+    OutputFormat format = OutputFormat::TEXT;
+    RunConfig config = {{0, Balance::STEAL, 0}, {{}, 0}, {0, 1}};
+    long long generate = 0;
+    int benchLo = 0, benchHi = 0, benchStep = 1;
+    SmpConfig& smp = config.smp;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-s") {
+            stream = true;
+        } else if ((arg == "-f" || arg == "-w") && i + 1 < argc) {
+            (arg == "-f" ? path : convertTo) = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            nthreads = atoi(argv[++i]);
+            if (nthreads < 1 || nthreads > MAX_WORKERS) {
+                cerr << "Error: thread count must be 1.." << MAX_WORKERS << "\n";
+                return 1;
+            }
+        } else if (arg == "-r" && i + 1 < argc) {
+            if (!parseSweep(argv[++i], sweepLo, sweepHi, sweepStep)) {
+                cerr << "Error: bad quantum range " << argv[i] << "\n";
+                return 1;
+            }
+            sweep = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            string f = argv[++i];
+            if (f == "text") {
+                format = OutputFormat::TEXT;
+            } else if (f == "csv") {
+                format = OutputFormat::CSV;
+            } else if (f == "json") {
+                format = OutputFormat::JSON;
+            } else {
+                cerr << "Error: unknown output format " << f << "\n";
+                return 1;
+            }
+        } else if (arg == "-c" && i + 1 < argc) {
+            smp.cpus = atoi(argv[++i]);
+            if (smp.cpus < 1) {
+                cerr << "Error: CPU count must be at least 1\n";
+                return 1;
+            }
+        } else if (arg == "-b" && i + 1 < argc) {
+            string b = argv[++i];
+            if (b == "global") {
+                smp.balance = Balance::GLOBAL;
+            } else if (b == "steal") {
+                smp.balance = Balance::STEAL;
+            } else {
+                cerr << "Error: unknown balancing mode " << b << "\n";
+                return 1;
+            }
+        } else if (arg == "-m" && i + 1 < argc) {
+            smp.migrationCost = atoll(argv[++i]);
+            if (smp.migrationCost < 0) {
+                cerr << "Error: migration cost must not be negative\n";
+                return 1;
+            }
+        } else if (arg == "-M" && i + 1 < argc) {
+            if (!parseMlfq(argv[++i], config.mlfq)) {
+                cerr << "Error: bad MLFQ spec " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "-F" && i + 1 < argc) {
+            if (!parseCfs(argv[++i], config.cfs)) {
+                cerr << "Error: bad CFS spec " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "-g" && i + 1 < argc) {
+            generate = atoll(argv[++i]);
+            if (generate < 1) {
+                cerr << "Error: job count must be at least 1\n";
+                return 1;
+            }
+        } else if (arg == "-B" && i + 1 < argc) {
+            if (!parseSweep(argv[++i], benchLo, benchHi, benchStep) || benchHi > BENCH_MAX_EXP) {
+                cerr << "Error: bad benchmark range " << argv[i] << " (exponents 1.." << BENCH_MAX_EXP << ")\n";
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            quantum = stoi(arg);
+        }
+    }
+
+    bool extraPolicies = !config.mlfq.quanta.empty() || config.cfs.latency > 0;
+    if (smp.cpus > 0 && extraPolicies) {
+        cerr << "Error: MLFQ and CFS are single-CPU only and cannot be used with -c\n";
+        return 1;
+    }
+
+    if (generate > 0) {
+        ProcessTable procs;
+        generateTrace(procs, generate, 1);
+        string out;
+        for (int i = 0; i < procs.size(); i++) {
+            out += to_string(procs.arrival[i]) + " " + to_string(procs.burst[i]) + "\n";
+            if (out.size() >= READ_BUF_SIZE) {
+                fwrite(out.data(), 1, out.size(), stdout);
+                out.clear();
+            }
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+        return 0;
+    }
+
+    if (benchHi > 0) {
+        runBenchmark(benchLo, benchHi, benchStep, quantum, config);
+        return 0;
+    }
+
+    TraceReader reader;
+    if (!reader.open(path)) {
+        cerr << "Error: cannot open " << path << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    long long a, b;
+
+    if (convertTo) {
+        int fd = open(convertTo, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            cerr << "Error: cannot create " << convertTo << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+        TraceWriter writer(fd);
+        while (reader.next(a, b)) writer.add(a, b);
+        bool ok = writer.flush();
+        close(fd);
+        if (reader.bad()) cerr << "Warning: trace input stopped at a malformed record\n";
+        return ok ? 0 : 1;
+    }
+
+    if (stream && (sweep || smp.cpus > 0 || extraPolicies)) {
+        cerr << "Error: -r, -c, -M and -F need the stored trace and cannot be used with -s\n";
+        return 1;
+    }
+
+    if (stream) {
+        FcfsSim fcfsSim;
+        RoundRobinSim rrSim(quantum);
+        long long count = 0;
+        while (reader.next(a, b)) {
+            fcfsSim.add(a, b);
+            rrSim.add(a, b);
+            count++;
+        }
+        if (reader.bad()) cerr << "Warning: trace input stopped at a malformed record\n";
+        if (count == 0) return 0;
+
+        Stats fcfs = fcfsSim.finish();
+        Stats rr = rrSim.finish();
+
+        if (format != OutputFormat::TEXT) {
+            vector<ReportRow> rows = {{"FCFS", 0, fcfs}, {"RR", quantum, rr}};
+            (format == OutputFormat::CSV ? printCsv : printJson)(rows);
+            return 0;
+        }
+
+        cout << "First Come, First Served\n";
+        printStats(fcfs);
+        cout << "\n";
+
+        cout << "Round Robin with Time Quantum of " << quantum << "\n";
+        printStats(rr);
+        return 0;
+    }
+
+    ProcessTable procs;
+    while (reader.next(a, b)) procs.add(a, b);
+    if (reader.bad()) cerr << "Warning: trace input stopped at a malformed record\n";
+
+    if (procs.size() == 0) return 0;
+    procs.seal();
+
+    // SJF/SRTF and the smallest quanta take longest, so they go first.
+    vector<EvalTask> tasks;
+    tasks.push_back(EvalTask{Policy::SRTF, 0, Stats()});
+    tasks.push_back(EvalTask{Policy::SJF, 0, Stats()});
+    if (sweep) {
+        for (long long q = sweepLo; q <= sweepHi; q += sweepStep) {
+            tasks.push_back(EvalTask{Policy::RR, (int)q, Stats()});
+        }
+    } else {
+        tasks.push_back(EvalTask{Policy::RR, quantum, Stats()});
+    }
+    if (!config.mlfq.quanta.empty()) tasks.push_back(EvalTask{Policy::MLFQ, 0, Stats()});
+    if (config.cfs.latency > 0) tasks.push_back(EvalTask{Policy::CFS, 0, Stats()});
+    tasks.push_back(EvalTask{Policy::FCFS, 0, Stats()});
+
+    evaluate(procs, config, tasks, nthreads);
+
+    // Report in policy order; RR quanta stay ascending.
+    stable_sort(tasks.begin(), tasks.end(),
+                [](const EvalTask& x, const EvalTask& y) { return x.policy < y.policy; });
+
+    if (format != OutputFormat::TEXT) {
+        vector<ReportRow> rows;
+        for (const EvalTask& task : tasks) {
+            rows.push_back(ReportRow{policyName(task.policy), task.quantum, task.result});
+        }
+        (format == OutputFormat::CSV ? printCsv : printJson)(rows);
+        return 0;
+    }
+
+    if (smp.cpus > 0) {
+        cout << smp.cpus << " CPUs, "
+             << (smp.balance == Balance::GLOBAL ? "global run queue" : "per-CPU run queues with work stealing")
+             << ", migration cost " << smp.migrationCost << "\n\n";
+    }
+
+    if (sweep) {
+        cout << fixed << setprecision(2);
+        cout << left << setw(10) << "Policy" << right
+             << setw(16) << "Avg. Resp." << setw(16) << "Avg. T.A."
+             << setw(16) << "Avg. Wait" << "\n";
+
+        const EvalTask* best = nullptr;
+        for (const EvalTask& task : tasks) {
+            string name = policyName(task.policy);
+            if (task.policy == Policy::RR) {
+                name += " q=" + to_string(task.quantum);
+                if (!best || task.result.avgWait < best->result.avgWait) best = &task;
+            }
+            printTableRow(name, task.result);
+        }
+        cout << "\nBest RR quantum by Avg. Wait: " << best->quantum << "\n";
+        return 0;
+    }
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (i > 0) cout << "\n";
+        cout << policyTitle(tasks[i], config) << "\n";
+        printStats(tasks[i].result);
+    }
+
+    return 0;
+}
@@ -1,196 +1,1330 @@
-#include <pthread.h>
-#include <cstdio>
-#include <cstdlib>
-#include <vector>
-
-static constexpr int BUF_CAP = 10;
-static constexpr int SENTINEL = -1;
-
-struct FactorResult {
-    int original;
-    std::vector<int> factors;
-};
-
-struct IntBuffer {
-    int items[BUF_CAP];
-    int head = 0, tail = 0, count = 0;
-    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
-    pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
-
-    void put(int v) {
-        pthread_mutex_lock(&mtx);
-        while (count == BUF_CAP) {
-            pthread_cond_wait(&not_full, &mtx);
-        }
-        items[tail] = v;
-        tail = (tail + 1) % BUF_CAP;
-        count++;
-        pthread_cond_signal(&not_empty);
-        pthread_mutex_unlock(&mtx);
-    }
-
-    int get() {
-        pthread_mutex_lock(&mtx);
-        while (count == 0) {
-            pthread_cond_wait(&not_empty, &mtx);
-        }
-        int v = items[head];
-        head = (head + 1) % BUF_CAP;
-        count--;
-        pthread_cond_signal(&not_full);
-        pthread_mutex_unlock(&mtx);
-        return v;
-    }
-};
-
-struct ResBuffer {
-    FactorResult* items[BUF_CAP];
-    int head = 0, tail = 0, count = 0;
-    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
-    pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
-
-    void put(FactorResult* p) {
-        pthread_mutex_lock(&mtx);
-        while (count == BUF_CAP) {
-            pthread_cond_wait(&not_full, &mtx);
-        }
-        items[tail] = p;
-        tail = (tail + 1) % BUF_CAP;
-        count++;
-        pthread_cond_signal(&not_empty);
-        pthread_mutex_unlock(&mtx);
-    }
-
-    FactorResult* get() {
-        pthread_mutex_lock(&mtx);
-        while (count == 0) {
-            pthread_cond_wait(&not_empty, &mtx);
-        }
-        FactorResult* p = items[head];
-        head = (head + 1) % BUF_CAP;
-        count--;
-        pthread_cond_signal(&not_full);
-        pthread_mutex_unlock(&mtx);
-        return p;
-    }
-};
-
-struct Shared {
-    IntBuffer* in;
-    ResBuffer* out;
-};
-
-static FactorResult* factor_number(int n) {
-    FactorResult* res = new (std::nothrow) FactorResult();
-    if (!res) return nullptr;
-
-    res->original = n;
-
-    int x = n;
-
-    while (x % 2 == 0) {
-        res->factors.push_back(2);
-        x /= 2;
-    }
-
-    for (int d = 3; (long long)d * d <= x; d += 2) {
-        while (x % d == 0) {
-            res->factors.push_back(d);
-            x /= d;
-        }
-    }
-
-    if (x > 1) {
-        res->factors.push_back(x);
-    }
-
-    return res;
-}
-
-static void* producer_main(void* arg) {
-    Shared* sh = static_cast<Shared*>(arg);
-
-    while (true) {
-        int n = sh->in->get();
-        if (n == SENTINEL) {
-            sh->out->put(nullptr); 
-            break;
-        }
-
-        FactorResult* res = factor_number(n);
-        if (!res) {
-            sh->out->put(nullptr); 
-            break;
-        }
-
-        sh->out->put(res);
-    }
-
-    return nullptr;
-}
-
-static void* consumer_main(void* arg) {
-    Shared* sh = static_cast<Shared*>(arg);
-
-    while (true) {
-        FactorResult* res = sh->out->get();
-        if (res == nullptr) break;
-
-        std::printf("%d:", res->original);
-        for (int f : res->factors) {
-            std::printf(" %d", f);
-        }
-        std::printf("\n");
-
-        delete res;
-    }
-
-    return nullptr;
-}
-
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::printf("Usage:%s <number to factor>...\n", argv[0]);
-        return 0;
-    }
-
-    int nnums = argc - 1;
-
-
-    IntBuffer inBuf;
-    ResBuffer outBuf;
-    Shared sh{&inBuf, &outBuf};
-
-    pthread_t producer, consumer;
-
-    if (pthread_create(&producer, nullptr, producer_main, &sh) != 0) {
-        std::fprintf(stderr, "Error: pthread_create producer failed\n");
-        return 1;
-    }
-    if (pthread_create(&consumer, nullptr, consumer_main, &sh) != 0) {
-        std::fprintf(stderr, "Error: pthread_create consumer failed\n");
-        inBuf.put(SENTINEL);
-        pthread_join(producer, nullptr);
-        return 1;
-    }
-
-    for (int i = 0; i < nnums; i++) {
-        int val = std::atoi(argv[i + 1]);
-        if (val < 2) {
-            std::fprintf(stderr, "Error: invalid input '%s' (must be >= 2)\n", argv[i + 1]);
-            inBuf.put(SENTINEL);
-            pthread_join(producer, nullptr);
-            pthread_join(consumer, nullptr);
-            return 1;
-        }
-        inBuf.put(val);
-    }
-
-    inBuf.put(SENTINEL);
-
-    pthread_join(producer, nullptr);
-    pthread_join(consumer, nullptr);
-    return 0;
-}
\ No newline at end of file
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static constexpr size_t DEFAULT_QUEUE_CAP = 1024;
+static constexpr int MAX_WORKERS = 256;
+static constexpr int SPIN_LIMIT = 256;
+static constexpr int MIN_BATCH = 1;
+static constexpr int MAX_BATCH = 256;
+static constexpr int SLAB_ITEMS = 16;
+static constexpr int MAX_FACTORS = 63;  // a 64-bit value has at most 63 prime factors
+static constexpr int PRIME_LIMIT = 65536;  // covers sqrt of any 32-bit value
+static constexpr int SIEVE_SEGMENT = 8192;
+static constexpr int TRIAL_CUTOFF = 1024;  // largest trial divisor for 64-bit cofactors
+static constexpr int RHO_BLOCK = 128;      // gcd batching in Pollard-Brent
+static constexpr int KERNEL_LANES = 16;    // candidates per step of the batch kernel
+static constexpr int KERNEL_PRIMES = 64;   // table primes the batch kernel tests
+static constexpr size_t DEFAULT_CACHE_ENTRIES = 32768;
+static constexpr int CACHE_SHARDS = 64;
+static constexpr int CACHE_MAX_FACTORS = 15;
+static constexpr uint64_t CACHE_MIN_VALUE = 1 << 20;  // smaller values factor faster than a lookup
+static constexpr size_t READ_BUF_SIZE = 1 << 20;
+static constexpr size_t WRITE_BUF_SIZE = 1 << 20;
+// Longest text record: 20 digits, ':', then MAX_FACTORS of ' ' + 20 digits, '\n'.
+static constexpr size_t MAX_RECORD = 22 + MAX_FACTORS * 21;
+
+enum class OutputFormat { TEXT, BINARY };
+
+typedef unsigned __int128 u128;
+
+struct FactorResult {
+    uint64_t original;
+    int count;
+    uint64_t factors[MAX_FACTORS];
+};
+
+// Unit of hand-off between stages. A worker turns one WorkBatch into one
+// ResultBatch carrying the same seq, so ordering is tracked per batch.
+struct WorkBatch {
+    long seq;
+    int count;
+    uint64_t values[MAX_BATCH];
+};
+
+struct ResultBatch {
+    long seq;
+    int count;
+    FactorResult results[MAX_BATCH];
+};
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Single-producer/single-consumer ring. Each side owns one index and keeps a
+// cached copy of the other so the shared cache line is only read when the
+// ring looks full or empty.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask_(capacity - 1), buf_(new T[capacity]) {}
+
+    bool try_push(const T& v) {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ > mask_) return false;
+        }
+        buf_[t & mask_] = v;
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& v) {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return false;
+        }
+        v = buf_[h & mask_];
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size_approx() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const size_t mask_;
+    std::unique_ptr<T[]> buf_;
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;
+};
+
+// Bounded multi-producer/multi-consumer ring (Vyukov). Every cell carries a
+// sequence number that tells producers and consumers whose turn it is.
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : mask_(capacity - 1), cells_(new Cell[capacity]) {
+        for (size_t i = 0; i < capacity; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(const T& v) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.data = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& v) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos & mask_];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    v = c.data;
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t size_approx() const {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        size_t h = head_.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// Spin-then-park waiting. A waiter spins on its try-operation for a while and
+// only then sleeps on the condvar; notify() takes the mutex only when someone
+// is actually parked.
+struct Parker {
+    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
+    std::atomic<int> waiters{0};
+
+    template <typename TryOp>
+    void wait(TryOp op) {
+        for (int i = 0; i < SPIN_LIMIT; i++) {
+            if (op()) return;
+            cpu_relax();
+        }
+
+        pthread_mutex_lock(&mtx);
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!op()) {
+            pthread_cond_wait(&cv, &mtx);
+        }
+        waiters.fetch_sub(1);
+        pthread_mutex_unlock(&mtx);
+    }
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0) return;
+        pthread_mutex_lock(&mtx);
+        pthread_cond_broadcast(&cv);
+        pthread_mutex_unlock(&mtx);
+    }
+};
+
+// Blocking queue over a lock-free ring. close() makes put() fail and lets
+// get() return false once the ring has drained.
+template <typename T, template <typename> class Ring>
+class Channel {
+public:
+    explicit Channel(size_t capacity) : ring_(capacity) {}
+
+    bool put(const T& v) {
+        bool ok = false;
+        not_full_.wait([&] {
+            if (closed_.load(std::memory_order_acquire)) return true;
+            ok = ring_.try_push(v);
+            return ok;
+        });
+        if (ok) not_empty_.notify();
+        return ok;
+    }
+
+    bool get(T& v) {
+        bool ok = false;
+        not_empty_.wait([&] {
+            if (ring_.try_pop(v)) return ok = true;
+            if (!closed_.load(std::memory_order_acquire)) return false;
+            ok = ring_.try_pop(v);
+            return true;
+        });
+        if (ok) not_full_.notify();
+        return ok;
+    }
+
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        not_empty_.notify();
+        not_full_.notify();
+    }
+
+    size_t size_approx() const { return ring_.size_approx(); }
+
+private:
+    Ring<T> ring_;
+    Parker not_empty_;
+    Parker not_full_;
+    std::atomic<bool> closed_{false};
+};
+
+template <typename T>
+using SpscChannel = Channel<T, SpscRing>;
+template <typename T>
+using MpmcChannel = Channel<T, MpmcRing>;
+
+// Slab allocator for batch objects. Objects are carved out of SLAB_ITEMS-sized
+// slabs and, once released, recycled through a lock-free free list so the
+// steady state does no heap traffic. Everything is freed with the pool.
+template <typename T>
+class SlabPool {
+public:
+    explicit SlabPool(size_t free_cap) : free_(free_cap) {}
+
+    T* acquire() {
+        T* p = nullptr;
+        if (free_.try_pop(p)) return p;
+
+        pthread_mutex_lock(&mtx_);
+        if (used_ == SLAB_ITEMS) {
+            T* slab = new (std::nothrow) T[SLAB_ITEMS];
+            if (slab) {
+                slabs_.emplace_back(slab);
+                used_ = 0;
+            }
+        }
+        if (used_ < SLAB_ITEMS) p = &slabs_.back()[used_++];
+        pthread_mutex_unlock(&mtx_);
+        return p;
+    }
+
+    // A full free list just strands the object until the pool is destroyed.
+    void release(T* p) { free_.try_push(p); }
+
+private:
+    MpmcRing<T*> free_;
+    pthread_mutex_t mtx_ = PTHREAD_MUTEX_INITIALIZER;
+    std::vector<std::unique_ptr<T[]>> slabs_;
+    int used_ = SLAB_ITEMS;
+};
+
+template <typename InQ, typename OutQ>
+struct Shared {
+    InQ* in;
+    OutQ* out;
+    SlabPool<WorkBatch>* work_pool;
+    SlabPool<ResultBatch>* res_pool;
+    OutputFormat format;
+    int nworkers;
+    std::atomic<bool> failed{false};
+};
+
+// All primes below PRIME_LIMIT. Built once in main before any worker starts
+// and only read afterwards, so workers share it without locking.
+static std::vector<int> primes;
+
+// Per-prime constants for testing 32-bit values without dividing: for odd p,
+// x is a multiple of p exactly when x * p^-1 (mod 2^32) <= UINT32_MAX / p.
+// prime_sq1 holds p*p - 1, so x <= prime_sq1 means p and later primes are
+// past sqrt(x). Entry 0 (p = 2) is unused.
+static std::vector<uint32_t> prime_inv;
+static std::vector<uint32_t> prime_lim;
+static std::vector<uint32_t> prime_sq1;
+
+// Segmented sieve: base primes up to sqrt(PRIME_LIMIT) come from a plain
+// sieve, then each cache-sized segment is crossed off with them.
+static void build_prime_table() {
+    int root = 1;
+    while ((root + 1) * (root + 1) <= PRIME_LIMIT) root++;
+
+    std::vector<char> small(root + 1, 1);
+    std::vector<int> base;
+    for (int i = 2; i <= root; i++) {
+        if (!small[i]) continue;
+        base.push_back(i);
+        for (int m = i * i; m <= root; m += i) small[m] = 0;
+    }
+
+    std::vector<char> seg(SIEVE_SEGMENT);
+    for (int lo = 2; lo < PRIME_LIMIT; lo += SIEVE_SEGMENT) {
+        int hi = std::min(lo + SIEVE_SEGMENT, PRIME_LIMIT);
+        std::fill(seg.begin(), seg.begin() + (hi - lo), 1);
+        for (int p : base) {
+            int start = std::max(p * p, (lo + p - 1) / p * p);
+            for (int m = start; m < hi; m += p) seg[m - lo] = 0;
+        }
+        for (int i = lo; i < hi; i++) {
+            if (seg[i - lo]) primes.push_back(i);
+        }
+    }
+
+    for (int p : primes) {
+        uint32_t inv = p;  // correct to 3 bits; each Newton step doubles that
+        for (int i = 0; i < 4; i++) inv *= 2 - (uint32_t)p * inv;
+        prime_inv.push_back(inv);
+        prime_lim.push_back(UINT32_MAX / p);
+        prime_sq1.push_back((uint32_t)p * p - 1);
+    }
+}
+
+// Batch trial-division kernels over the first KERNEL_PRIMES odd primes. For
+// each odd 32-bit value, out receives the index of the first of those primes
+// that divides it or whose square exceeds it, else the index just past them.
+// Trial division can start at that index. n must be a multiple of
+// KERNEL_LANES.
+typedef void (*SmallFactorKernel)(const uint32_t* v, int n, int32_t* out);
+
+static int kernel_prime_end() {
+    return std::min<int>(KERNEL_PRIMES + 1, (int)primes.size());
+}
+
+static void small_factor_scalar(const uint32_t* v, int n, int32_t* out) {
+    int np = kernel_prime_end();
+    for (int i = 0; i < n; i++) {
+        uint32_t x = v[i];
+        int k = 1;
+        while (k < np && x > prime_sq1[k] && x * prime_inv[k] > prime_lim[k]) k++;
+        out[i] = k;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Two 8-lane vectors per step. Lanes retire as they find their index, and
+// the group stops as soon as every lane has.
+__attribute__((target("avx2")))
+static void small_factor_avx2(const uint32_t* v, int n, int32_t* out) {
+    int np = kernel_prime_end();
+    const __m256i ones = _mm256_set1_epi32(-1);
+
+    for (int i = 0; i < n; i += KERNEL_LANES) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(v + i));
+        __m256i x1 = _mm256_loadu_si256((const __m256i*)(v + i + 8));
+        __m256i live0 = ones, live1 = ones;
+        __m256i idx0 = _mm256_set1_epi32(np), idx1 = idx0;
+
+        for (int k = 1; k < np; k++) {
+            __m256i inv = _mm256_set1_epi32((int)prime_inv[k]);
+            __m256i lim = _mm256_set1_epi32((int)prime_lim[k]);
+            __m256i sq1 = _mm256_set1_epi32((int)prime_sq1[k]);
+            __m256i kk = _mm256_set1_epi32(k);
+
+            // Unsigned a <= b is min(a, b) == a.
+            __m256i q0 = _mm256_mullo_epi32(x0, inv);
+            __m256i q1 = _mm256_mullo_epi32(x1, inv);
+            __m256i stop0 = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_min_epu32(q0, lim), q0),
+                                            _mm256_cmpeq_epi32(_mm256_min_epu32(x0, sq1), x0));
+            __m256i stop1 = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_min_epu32(q1, lim), q1),
+                                            _mm256_cmpeq_epi32(_mm256_min_epu32(x1, sq1), x1));
+            stop0 = _mm256_and_si256(stop0, live0);
+            stop1 = _mm256_and_si256(stop1, live1);
+
+            idx0 = _mm256_blendv_epi8(idx0, kk, stop0);
+            idx1 = _mm256_blendv_epi8(idx1, kk, stop1);
+            live0 = _mm256_andnot_si256(stop0, live0);
+            live1 = _mm256_andnot_si256(stop1, live1);
+
+            __m256i live = _mm256_or_si256(live0, live1);
+            if (_mm256_testz_si256(live, live)) break;
+        }
+
+        _mm256_storeu_si256((__m256i*)(out + i), idx0);
+        _mm256_storeu_si256((__m256i*)(out + i + 8), idx1);
+    }
+}
+#endif
+
+// Picked in main once the prime table exists.
+static SmallFactorKernel small_factor_kernel = small_factor_scalar;
+
+static void select_small_factor_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) small_factor_kernel = small_factor_avx2;
+#endif
+}
+
+// Runs the batch kernel over the odd values below 2^32 in a batch and
+// returns a starting prime index for each value (0 for the rest). Most
+// composites are resolved by the kernel; only the survivors pay for scalar
+// trial division over the rest of the table.
+static void trial_start_hints(const uint64_t* values, int n, int32_t* starts) {
+    uint32_t lanes[MAX_BATCH];
+    int32_t found[MAX_BATCH];
+    int index[MAX_BATCH];
+    int m = 0;
+
+    for (int i = 0; i < n; i++) {
+        starts[i] = 0;
+        if (values[i] <= UINT32_MAX && (values[i] & 1)) {
+            lanes[m] = (uint32_t)values[i];
+            index[m++] = i;
+        }
+    }
+    if (m == 0) return;
+
+    // Pad with 1s, which retire on the first prime.
+    int padded = (m + KERNEL_LANES - 1) / KERNEL_LANES * KERNEL_LANES;
+    for (int j = m; j < padded; j++) lanes[j] = 1;
+
+    small_factor_kernel(lanes, padded, found);
+    for (int j = 0; j < m; j++) starts[index[j]] = found[j];
+}
+
+// Arithmetic modulo an odd 64-bit n in Montgomery form (R = 2^64).
+struct Montgomery {
+    uint64_t n;
+    uint64_t ninv;  // n * ninv == 1 (mod 2^64)
+    uint64_t r2;    // R^2 mod n
+    uint64_t one;   // R mod n
+
+    explicit Montgomery(uint64_t mod) : n(mod) {
+        ninv = n;  // correct to 3 bits; each Newton step doubles that
+        for (int i = 0; i < 5; i++) ninv *= 2 - n * ninv;
+        one = (0 - n) % n;
+        r2 = (uint64_t)((u128)one * one % n);
+    }
+
+    uint64_t reduce(u128 t) const {
+        uint64_t m = (uint64_t)t * ninv;
+        uint64_t hi = (uint64_t)(t >> 64);
+        uint64_t mn = (uint64_t)(((u128)m * n) >> 64);
+        return hi >= mn ? hi - mn : hi - mn + n;
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce((u128)a * b); }
+    uint64_t to(uint64_t a) const { return mul(a % n, r2); }
+
+    uint64_t add(uint64_t a, uint64_t b) const {
+        uint64_t s = a + b;
+        return (s < a || s >= n) ? s - n : s;
+    }
+
+    uint64_t pow(uint64_t a, uint64_t e) const {
+        uint64_t r = one;
+        while (e) {
+            if (e & 1) r = mul(r, a);
+            a = mul(a, a);
+            e >>= 1;
+        }
+        return r;
+    }
+};
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    do {
+        b >>= __builtin_ctzll(b);
+        if (a > b) std::swap(a, b);
+        b -= a;
+    } while (b);
+    return a << shift;
+}
+
+// Deterministic Miller-Rabin: these seven bases are exact for all n < 2^64.
+static bool is_prime_u64(uint64_t n) {
+    static const uint64_t small[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    static const uint64_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+    if (n < 2) return false;
+    for (uint64_t p : small) {
+        if (n % p == 0) return n == p;
+    }
+    if (n < 37 * 37) return true;
+
+    uint64_t d = n - 1;
+    int s = __builtin_ctzll(d);
+    d >>= s;
+
+    Montgomery m(n);
+    uint64_t minus_one = n - m.one;
+    for (uint64_t b : bases) {
+        uint64_t a = b % n;
+        if (a == 0) continue;
+        uint64_t x = m.pow(m.to(a), d);
+        if (x == m.one || x == minus_one) continue;
+        bool witness = true;
+        for (int i = 1; i < s && witness; i++) {
+            x = m.mul(x, x);
+            if (x == minus_one) witness = false;
+        }
+        if (witness) return false;
+    }
+    return true;
+}
+
+// Pollard rho with Brent's cycle detection on f(y) = y^2 + c. Differences
+// are multiplied together RHO_BLOCK at a time so only one gcd is taken per
+// block; a block that overshoots to gcd == n is replayed one step at a time.
+// n must be odd and composite; returns a nontrivial divisor.
+static uint64_t pollard_brent(uint64_t n) {
+    Montgomery m(n);
+
+    for (uint64_t c0 = 1;; c0++) {
+        uint64_t c = m.to(c0);
+        uint64_t y = m.to(2), x = y, ys = y;
+        uint64_t q = m.one;
+        uint64_t g = 1;
+
+        for (uint64_t r = 1; g == 1; r <<= 1) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = m.add(m.mul(y, y), c);
+
+            for (uint64_t k = 0; k < r && g == 1; k += RHO_BLOCK) {
+                ys = y;
+                uint64_t lim = std::min<uint64_t>(RHO_BLOCK, r - k);
+                for (uint64_t i = 0; i < lim; i++) {
+                    y = m.add(m.mul(y, y), c);
+                    q = m.mul(q, x > y ? x - y : y - x);
+                }
+                g = gcd_u64(q, n);
+            }
+        }
+
+        if (g == n) {
+            do {
+                ys = m.add(m.mul(ys, ys), c);
+                g = gcd_u64(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+
+        if (g != n) return g;
+    }
+}
+
+// Splits an odd cofactor with no small factors into primes (unsorted).
+static void factor_large(uint64_t n, FactorResult* res) {
+    if (n == 1) return;
+    if (is_prime_u64(n)) {
+        res->factors[res->count++] = n;
+        return;
+    }
+    uint64_t d = pollard_brent(n);
+    factor_large(d, res);
+    factor_large(n / d, res);
+}
+
+// Size-bounded map from a number to its sorted prime factors, shared by all
+// workers. Keys hash to one of CACHE_SHARDS shards, each a direct-mapped
+// table behind its own mutex; a colliding insert simply evicts the old
+// entry. Factorizations longer than CACHE_MAX_FACTORS are not cached since
+// such numbers are mostly small primes and cheap to redo.
+class FactorCache {
+public:
+    explicit FactorCache(size_t entries) {
+        size_t per_shard = 1;
+        while (per_shard * CACHE_SHARDS < entries) per_shard <<= 1;
+        mask_ = per_shard - 1;
+        for (Shard& sh : shards_) {
+            sh.slots.reset(new Entry[per_shard]());
+        }
+    }
+
+    // On a hit, appends the cached factors of key to res.
+    bool lookup(uint64_t key, FactorResult* res) {
+        uint64_t h = hash(key);
+        Shard& sh = shards_[h >> 58];
+        pthread_mutex_lock(&sh.mtx);
+        const Entry& e = sh.slots[h & mask_];
+        bool hit = e.key == key;
+        if (hit) {
+            std::memcpy(res->factors + res->count, e.factors, e.count * sizeof(uint64_t));
+            res->count += e.count;
+            sh.hits++;
+        } else {
+            sh.misses++;
+        }
+        pthread_mutex_unlock(&sh.mtx);
+        return hit;
+    }
+
+    void insert(uint64_t key, const uint64_t* factors, int count) {
+        if (count > CACHE_MAX_FACTORS) return;
+        uint64_t h = hash(key);
+        Shard& sh = shards_[h >> 58];
+        pthread_mutex_lock(&sh.mtx);
+        Entry& e = sh.slots[h & mask_];
+        e.key = key;
+        e.count = count;
+        std::memcpy(e.factors, factors, count * sizeof(uint64_t));
+        pthread_mutex_unlock(&sh.mtx);
+    }
+
+    // Only meaningful once the workers have been joined.
+    uint64_t hits() const {
+        uint64_t n = 0;
+        for (const Shard& sh : shards_) n += sh.hits;
+        return n;
+    }
+
+    uint64_t misses() const {
+        uint64_t n = 0;
+        for (const Shard& sh : shards_) n += sh.misses;
+        return n;
+    }
+
+private:
+    static_assert(CACHE_SHARDS == 64, "shard index uses the top 6 hash bits");
+
+    struct Entry {
+        uint64_t key;  // 0 marks an empty slot; inputs are always >= 2
+        int count;
+        uint64_t factors[CACHE_MAX_FACTORS];
+    };
+
+    struct alignas(64) Shard {
+        pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+        std::unique_ptr<Entry[]> slots;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    static uint64_t hash(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    Shard shards_[CACHE_SHARDS];
+    size_t mask_;
+};
+
+// Created in main before any worker starts; null when caching is disabled.
+static std::unique_ptr<FactorCache> cache;
+
+// Tracks one factorization's cache traffic. Every cofactor that missed is
+// remembered along with where its factors start in res; since factors come
+// out in nondecreasing order, its factorization is exactly that suffix.
+struct CacheProbe {
+    FactorResult* res;
+    int nmissed = 0;
+    uint64_t missed[MAX_FACTORS + 1];
+    int missed_at[MAX_FACTORS + 1];
+
+    explicit CacheProbe(FactorResult* r) : res(r) {}
+
+    bool hit(uint64_t x) {
+        if (!cache || x < CACHE_MIN_VALUE) return false;
+        if (cache->lookup(x, res)) return true;
+        missed[nmissed] = x;
+        missed_at[nmissed++] = res->count;
+        return false;
+    }
+
+    void remember() {
+        for (int i = 0; i < nmissed; i++) {
+            cache->insert(missed[i], res->factors + missed_at[i], res->count - missed_at[i]);
+        }
+    }
+};
+
+// Trial division by the prime table, then Miller-Rabin / Pollard rho for
+// whatever is left. Values below 2^32 are finished by the table alone. The
+// cache is consulted for the input and again each time trial division
+// shrinks the cofactor.
+static void factor_cofactor(uint64_t x, int start, FactorResult* res, CacheProbe& probe) {
+    bool exhausted = false;
+
+    for (size_t k = start; k < primes.size(); k++) {
+        int p = primes[k];
+        if ((uint64_t)p * p > x) {
+            exhausted = true;
+            break;
+        }
+        if (x > UINT32_MAX) {
+            if (p > TRIAL_CUTOFF) break;
+        } else if (k > 0 && (uint32_t)x * prime_inv[k] > prime_lim[k]) {
+            continue;  // not a multiple; skips the hardware divide
+        }
+        if (x % p != 0) continue;
+        do {
+            res->factors[res->count++] = p;
+            x /= p;
+        } while (x % p == 0);
+        if (probe.hit(x)) return;
+    }
+
+    if (x == 1) return;
+    if (exhausted || x <= UINT32_MAX) {
+        res->factors[res->count++] = x;
+        return;
+    }
+
+    int first = res->count;
+    factor_large(x, res);
+    std::sort(res->factors + first, res->factors + res->count);
+}
+
+// start is the first prime index trial division needs to try (see
+// trial_start_hints); 0 always works.
+static void factor_number(uint64_t n, int start, FactorResult* res) {
+    res->original = n;
+    res->count = 0;
+
+    CacheProbe probe(res);
+    if (!probe.hit(n)) factor_cofactor(n, start, res, probe);
+    probe.remember();
+}
+
+// Worker: factors batches from the shared input queue until it is closed.
+// Each worker posts exactly one nullptr to the result queue when it exits.
+template <typename InQ, typename OutQ>
+static void* producer_main(void* arg) {
+    Shared<InQ, OutQ>* sh = static_cast<Shared<InQ, OutQ>*>(arg);
+
+    WorkBatch* wb = nullptr;
+    int32_t starts[MAX_BATCH];
+    while (sh->in->get(wb)) {
+        ResultBatch* rb = sh->res_pool->acquire();
+        if (!rb) {
+            sh->work_pool->release(wb);
+            sh->failed.store(true);
+            sh->in->close();
+            break;
+        }
+
+        rb->seq = wb->seq;
+        rb->count = wb->count;
+        trial_start_hints(wb->values, wb->count, starts);
+        for (int i = 0; i < wb->count; i++) {
+            factor_number(wb->values[i], starts[i], &rb->results[i]);
+        }
+        sh->work_pool->release(wb);
+
+        sh->out->put(rb);
+    }
+
+    sh->out->put(nullptr);
+    return nullptr;
+}
+
+// Writes u64 in decimal at p and returns the end. Two digits per step from a
+// lookup table, written back to front into a scratch buffer.
+static char* format_u64(char* p, uint64_t v) {
+    static const char pairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char tmp[20];
+    char* t = tmp + sizeof(tmp);
+    while (v >= 100) {
+        unsigned r = (unsigned)(v % 100);
+        v /= 100;
+        t -= 2;
+        std::memcpy(t, pairs + 2 * r, 2);
+    }
+    if (v >= 10) {
+        t -= 2;
+        std::memcpy(t, pairs + 2 * v, 2);
+    } else {
+        *--t = (char)('0' + v);
+    }
+    size_t len = tmp + sizeof(tmp) - t;
+    std::memcpy(p, t, len);
+    return p + len;
+}
+
+// Output stage owned by the consumer thread. Records are formatted into one
+// WRITE_BUF_SIZE buffer that goes out with write(2) whenever it fills, so
+// stdio locking and varargs formatting are off the hot path.
+//
+// The binary format is a stream of native-endian records:
+//   uint64_t original; uint32_t count; uint64_t factors[count];
+class OutputWriter {
+public:
+    OutputWriter(int fd, OutputFormat format)
+        : fd_(fd), format_(format), buf_(new char[WRITE_BUF_SIZE]) {}
+
+    ~OutputWriter() { flush(); }
+
+    void write_result(const FactorResult* res) {
+        if (WRITE_BUF_SIZE - len_ < MAX_RECORD) flush();
+        char* p = buf_.get() + len_;
+
+        if (format_ == OutputFormat::BINARY) {
+            uint32_t count = res->count;
+            std::memcpy(p, &res->original, sizeof(uint64_t));
+            p += sizeof(uint64_t);
+            std::memcpy(p, &count, sizeof(uint32_t));
+            p += sizeof(uint32_t);
+            std::memcpy(p, res->factors, count * sizeof(uint64_t));
+            p += count * sizeof(uint64_t);
+        } else {
+            p = format_u64(p, res->original);
+            *p++ = ':';
+            for (int k = 0; k < res->count; k++) {
+                *p++ = ' ';
+                p = format_u64(p, res->factors[k]);
+            }
+            *p++ = '\n';
+        }
+
+        len_ = p - buf_.get();
+    }
+
+    void write_batch(const ResultBatch* rb) {
+        for (int i = 0; i < rb->count; i++) {
+            write_result(&rb->results[i]);
+        }
+    }
+
+    // On a write error the rest of the output is dropped.
+    void flush() {
+        const char* p = buf_.get();
+        size_t left = len_;
+        while (left > 0 && !failed_) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                failed_ = true;
+                break;
+            }
+            p += n;
+            left -= n;
+        }
+        len_ = 0;
+    }
+
+private:
+    int fd_;
+    OutputFormat format_;
+    std::unique_ptr<char[]> buf_;
+    size_t len_ = 0;
+    bool failed_ = false;
+};
+
+// Consumer: workers finish out of order, so batches are held in a reorder
+// stage keyed on batch sequence number and printed once they are contiguous.
+template <typename InQ, typename OutQ>
+static void* consumer_main(void* arg) {
+    Shared<InQ, OutQ>* sh = static_cast<Shared<InQ, OutQ>*>(arg);
+
+    OutputWriter out(STDOUT_FILENO, sh->format);
+    std::map<long, ResultBatch*> pending;
+    long next_seq = 0;
+    int live = sh->nworkers;
+
+    while (live > 0) {
+        // Push finished output downstream before waiting on slow workers.
+        if (sh->out->size_approx() == 0) out.flush();
+
+        ResultBatch* rb = nullptr;
+        sh->out->get(rb);
+        if (rb == nullptr) {
+            live--;
+            continue;
+        }
+
+        if (rb->seq != next_seq) {
+            pending.emplace(rb->seq, rb);
+            continue;
+        }
+
+        out.write_batch(rb);
+        sh->res_pool->release(rb);
+        next_seq++;
+
+        auto it = pending.begin();
+        while (it != pending.end() && it->first == next_seq) {
+            out.write_batch(it->second);
+            sh->res_pool->release(it->second);
+            it = pending.erase(it);
+            next_seq++;
+        }
+    }
+
+    // Anything left over (a gap after a worker failure) is owned by the pool.
+    return nullptr;
+}
+
+// Feeds input to the workers in batches. The batch size doubles while the
+// input queue is backing up (workers are saturated, so amortize hand-offs)
+// and halves when it has run dry (workers are idle, so hand work over sooner).
+template <typename InQ>
+class Batcher {
+public:
+    Batcher(InQ* q, SlabPool<WorkBatch>* pool, size_t qcap)
+        : q_(q), pool_(pool), high_water_(qcap / 2) {}
+
+    ~Batcher() {
+        if (cur_) pool_->release(cur_);
+    }
+
+    bool add(uint64_t v) {
+        if (!cur_) {
+            cur_ = pool_->acquire();
+            if (!cur_) {
+                out_of_memory_ = true;
+                return false;
+            }
+            cur_->seq = next_seq_++;
+            cur_->count = 0;
+        }
+        cur_->values[cur_->count++] = v;
+        if (cur_->count < size_) return true;
+        return flush();
+    }
+
+    bool flush() {
+        if (!cur_) return true;
+
+        size_t backlog = q_->size_approx();
+        if (backlog >= high_water_ && size_ < MAX_BATCH) {
+            size_ *= 2;
+        } else if (backlog == 0 && size_ > MIN_BATCH) {
+            size_ /= 2;
+        }
+
+        WorkBatch* wb = cur_;
+        cur_ = nullptr;
+        if (!q_->put(wb)) {
+            pool_->release(wb);
+            return false;
+        }
+        return true;
+    }
+
+    // True once add() has failed for want of a batch.
+    bool out_of_memory() const { return out_of_memory_; }
+
+private:
+    InQ* q_;
+    SlabPool<WorkBatch>* pool_;
+    size_t high_water_;
+    WorkBatch* cur_ = nullptr;
+    long next_seq_ = 0;
+    int size_ = MIN_BATCH;
+    bool out_of_memory_ = false;
+};
+
+// Decimal digits only (no sign), and the whole string must fit in 64 bits.
+static bool parse_u64(const char* s, uint64_t* out) {
+    if (*s < '0' || *s > '9') return false;
+    errno = 0;
+    char* end;
+    unsigned long long v = std::strtoull(s, &end, 10);
+    if (errno != 0 || *end != '\0') return false;
+    *out = v;
+    return true;
+}
+
+// Newline/whitespace separated decimal numbers from a file or stdin. Regular
+// files are mapped whole; pipes and terminals go through one READ_BUF_SIZE
+// buffer, so memory use does not depend on input size.
+class NumberReader {
+public:
+    enum Status { NUMBER, END, BAD };
+
+    ~NumberReader() {
+        if (map_) munmap(map_, map_len_);
+        if (fd_ > 0) ::close(fd_);
+    }
+
+    bool open(const char* path) {
+        if (std::strcmp(path, "-") == 0) {
+            fd_ = STDIN_FILENO;
+        } else {
+            fd_ = ::open(path, O_RDONLY);
+            if (fd_ < 0) return false;
+        }
+
+        struct stat st;
+        if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (m != MAP_FAILED) {
+                madvise(m, st.st_size, MADV_SEQUENTIAL);
+                map_ = static_cast<char*>(m);
+                map_len_ = st.st_size;
+                pos_ = map_;
+                end_ = map_ + map_len_;
+                eof_ = true;
+                return true;
+            }
+        }
+
+        buf_.reset(new (std::nothrow) char[READ_BUF_SIZE]);
+        return buf_ != nullptr;
+    }
+
+    // True when the next call to next() would have to wait for more input.
+    bool drained() const { return pos_ == end_ && !eof_; }
+
+    long line() const { return line_; }
+
+    Status next(uint64_t& v) {
+        int c;
+        while ((c = peek()) == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            if (c == '\n') line_++;
+            pos_++;
+        }
+        if (c < 0) return END;
+
+        v = 0;
+        int ndigits = 0;
+        while ((c = peek()) >= '0' && c <= '9') {
+            uint64_t d = c - '0';
+            if (v > (UINT64_MAX - d) / 10) return BAD;
+            v = v * 10 + d;
+            ndigits++;
+            pos_++;
+        }
+
+        if (ndigits == 0) return BAD;
+        if (c >= 0 && c != ' ' && c != '\t' && c != '\r' && c != '\n') return BAD;
+        return NUMBER;
+    }
+
+private:
+    int peek() {
+        if (pos_ == end_ && !refill()) return -1;
+        return (unsigned char)*pos_;
+    }
+
+    bool refill() {
+        if (eof_) return false;
+        ssize_t n;
+        do {
+            n = ::read(fd_, buf_.get(), READ_BUF_SIZE);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            eof_ = true;
+            return false;
+        }
+        pos_ = buf_.get();
+        end_ = pos_ + n;
+        return true;
+    }
+
+    int fd_ = -1;
+    char* map_ = nullptr;
+    size_t map_len_ = 0;
+    std::unique_ptr<char[]> buf_;
+    const char* pos_ = nullptr;
+    const char* end_ = nullptr;
+    bool eof_ = false;
+    long line_ = 1;
+};
+
+struct Input {
+    char** nums;
+    int nnums;
+    NumberReader* reader;  // streaming mode when non-null
+};
+
+template <typename InQ>
+static int feed_args(Batcher<InQ>& batcher, char** nums, int nnums) {
+    for (int i = 0; i < nnums; i++) {
+        uint64_t val;
+        if (!parse_u64(nums[i], &val) || val < 2) {
+            std::fprintf(stderr, "Error: invalid input '%s' (must be >= 2 and fit in 64 bits)\n", nums[i]);
+            batcher.flush();
+            return 1;
+        }
+        if (!batcher.add(val)) return 0;
+    }
+    batcher.flush();
+    return 0;
+}
+
+// Partial batches are handed off before the reader blocks on a slow pipe, so
+// numbers never sit in the feeder while workers idle.
+template <typename InQ>
+static int feed_stream(Batcher<InQ>& batcher, NumberReader& reader) {
+    for (;;) {
+        if (reader.drained() && !batcher.flush()) return 0;
+
+        uint64_t val;
+        NumberReader::Status st = reader.next(val);
+        if (st == NumberReader::END) break;
+        if (st == NumberReader::BAD || val < 2) {
+            std::fprintf(stderr, "Error: invalid input on line %ld (must be >= 2 and fit in 64 bits)\n",
+                         reader.line());
+            batcher.flush();
+            return 1;
+        }
+        if (!batcher.add(val)) return 0;
+    }
+    batcher.flush();
+    return 0;
+}
+
+// Discards results until every started worker has signed off, so none is
+// left blocked on a full result queue. Used when there is no consumer.
+template <typename InQ, typename OutQ>
+static void drain_results(Shared<InQ, OutQ>& sh) {
+    int live = sh.nworkers;
+    while (live > 0) {
+        ResultBatch* rb = nullptr;
+        sh.out->get(rb);
+        if (rb == nullptr) {
+            live--;
+        } else {
+            sh.res_pool->release(rb);
+        }
+    }
+}
+
+template <typename InQ, typename OutQ>
+static int run_pipeline(int nworkers, size_t qcap, OutputFormat format, const Input& input) {
+    InQ inBuf(qcap);
+    OutQ outBuf(qcap);
+    // Batches in flight are bounded by both queues plus one per thread and
+    // whatever the reorder stage holds; size the free lists generously.
+    SlabPool<WorkBatch> workPool(qcap * 4);
+    SlabPool<ResultBatch> resPool(qcap * 4);
+    Shared<InQ, OutQ> sh{&inBuf, &outBuf, &workPool, &resPool, format, 0};
+
+    pthread_t workers[MAX_WORKERS];
+    pthread_t consumer;
+
+    for (int i = 0; i < nworkers; i++) {
+        if (pthread_create(&workers[i], nullptr, producer_main<InQ, OutQ>, &sh) != 0) {
+            std::fprintf(stderr, "Error: pthread_create worker failed\n");
+            inBuf.close();
+            drain_results(sh);
+            for (int j = 0; j < sh.nworkers; j++) pthread_join(workers[j], nullptr);
+            return 1;
+        }
+        sh.nworkers++;
+    }
+
+    if (pthread_create(&consumer, nullptr, consumer_main<InQ, OutQ>, &sh) != 0) {
+        std::fprintf(stderr, "Error: pthread_create consumer failed\n");
+        inBuf.close();
+        drain_results(sh);
+        for (int i = 0; i < sh.nworkers; i++) pthread_join(workers[i], nullptr);
+        return 1;
+    }
+
+    int rc;
+    {
+        Batcher<InQ> batcher(&inBuf, &workPool, qcap);
+        if (input.reader) {
+            rc = feed_stream(batcher, *input.reader);
+        } else {
+            rc = feed_args(batcher, input.nums, input.nnums);
+        }
+        if (batcher.out_of_memory()) sh.failed.store(true);
+    }
+
+    inBuf.close();
+
+    for (int i = 0; i < sh.nworkers; i++) pthread_join(workers[i], nullptr);
+    pthread_join(consumer, nullptr);
+
+    if (sh.failed.load()) {
+        std::fprintf(stderr, "Error: factorization failed (out of memory)\n");
+        rc = 1;
+    }
+    return rc;
+}
+
+static int default_workers() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_WORKERS) return MAX_WORKERS;
+    return (int)n;
+}
+
+static void usage(const char* prog) {
+    std::printf("Usage:%s [options] <number to factor>...\n", prog);
+    std::printf("       %s [options] -f <file|->\n", prog);
+    std::printf("Options: -t threads  -q queue_capacity  -o text|binary\n");
+    std::printf("         -c cache_entries (0 disables)  -s (print cache stats to stderr)\n");
+}
+
+int main(int argc, char* argv[]) {
+    int nworkers = default_workers();
+    size_t qcap = DEFAULT_QUEUE_CAP;
+    const char* path = nullptr;
+    OutputFormat format = OutputFormat::TEXT;
+    size_t cache_entries = DEFAULT_CACHE_ENTRIES;
+    bool show_stats = false;
+    int argi = 1;
+
+    while (argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0' && argv[argi][2] == '\0') {
+        if (argv[argi][1] == 's') {
+            show_stats = true;
+            argi++;
+            continue;
+        }
+        if (argi + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char* val = argv[argi + 1];
+        switch (argv[argi][1]) {
+        case 't':
+            nworkers = std::atoi(val);
+            if (nworkers < 1 || nworkers > MAX_WORKERS) {
+                std::fprintf(stderr, "Error: invalid thread count '%s' (must be 1-%d)\n",
+                             val, MAX_WORKERS);
+                return 1;
+            }
+            break;
+        case 'q':
+            qcap = std::strtoul(val, nullptr, 10);
+            if (qcap < 2 || (qcap & (qcap - 1)) != 0) {
+                std::fprintf(stderr, "Error: invalid queue capacity '%s' (must be a power of two >= 2)\n",
+                             val);
+                return 1;
+            }
+            break;
+        case 'f':
+            path = val;
+            break;
+        case 'c':
+            cache_entries = std::strtoul(val, nullptr, 10);
+            break;
+        case 'o':
+            if (std::strcmp(val, "text") == 0) {
+                format = OutputFormat::TEXT;
+            } else if (std::strcmp(val, "binary") == 0) {
+                format = OutputFormat::BINARY;
+            } else {
+                std::fprintf(stderr, "Error: invalid output format '%s' (must be text or binary)\n", val);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+        argi += 2;
+    }
+
+    if ((argi >= argc) == (path == nullptr)) {
+        usage(argv[0]);
+        return path ? 1 : 0;
+    }
+
+    NumberReader reader;
+    Input input{argv + argi, argc - argi, nullptr};
+    if (path) {
+        if (!reader.open(path)) {
+            std::fprintf(stderr, "Error: cannot open '%s': %s\n", path, std::strerror(errno));
+            return 1;
+        }
+        input.reader = &reader;
+    }
+
+    build_prime_table();
+    select_small_factor_kernel();
+    if (cache_entries > 0) cache.reset(new FactorCache(cache_entries));
+
+    // With one worker every queue has exactly one producer and one consumer.
+    int rc;
+    if (nworkers == 1) {
+        rc = run_pipeline<SpscChannel<WorkBatch*>, SpscChannel<ResultBatch*>>(
+            nworkers, qcap, format, input);
+    } else {
+        rc = run_pipeline<MpmcChannel<WorkBatch*>, MpmcChannel<ResultBatch*>>(
+            nworkers, qcap, format, input);
+    }
+
+    if (show_stats && cache) {
+        uint64_t hits = cache->hits(), misses = cache->misses();
+        uint64_t total = hits + misses;
+        std::fprintf(stderr, "Cache: %llu hits, %llu misses (%.1f%% hit rate)\n",
+                     (unsigned long long)hits, (unsigned long long)misses,
+                     total ? 100.0 * hits / total : 0.0);
+    }
+    return rc;
+}
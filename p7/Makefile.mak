@@ -1,5 +1,10 @@
-all:
-	gcc -o p7 p7.c
-
-clean:
-	rm -f p7
\ No newline at end of file
+CC=gcc
+CFLAGS=-Wall -Wextra -O2 -pthread
+
+all: p7
+
+p7: p7.c
+	$(CC) $(CFLAGS) -o p7 p7.c -lm
+
+clean:
+	rm -f p7
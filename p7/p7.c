@@ -1,170 +1,1201 @@
-#include <stdio.h>
-#include <stdlib.h>
-
-#define MAX 100
-
-// Function prototypes
-int fcfs(int arr[], int n);
-int sstf(int arr[], int n);
-int look(int arr[], int n);
-int clook(int arr[], int n);
-
-// Absolute difference
-int diff(int a, int b) {
-    return abs(a - b);
-}
-
-// ---------------- FCFS ----------------
-int fcfs(int arr[], int n) {
-    int total = 0;
-
-    for (int i = 0; i < n - 1; i++) {
-        total += diff(arr[i], arr[i + 1]);
-    }
-
-    return total;
-}
-
-// ---------------- SSTF ----------------
-int sstf(int arr[], int n) {
-    int visited[MAX] = {0};
-    int total = 0;
-    int current = arr[0];
-
-    visited[0] = 1;
-
-    for (int i = 1; i < n; i++) {
-        int minDist = 100000;
-        int index = -1;
-
-        for (int j = 1; j < n; j++) {
-            if (!visited[j]) {
-                int d = diff(current, arr[j]);
-                if (d < minDist) {
-                    minDist = d;
-                    index = j;
-                }
-            }
-        }
-
-        visited[index] = 1;
-        total += minDist;
-        current = arr[index];
-    }
-
-    return total;
-}
-
-// ---------------- SORT ----------------
-void sort(int arr[], int n) {
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (arr[i] > arr[j]) {
-                int temp = arr[i];
-                arr[i] = arr[j];
-                arr[j] = temp;
-            }
-        }
-    }
-}
-
-// ---------------- LOOK ----------------
-int look(int arr[], int n) {
-    int temp[MAX];
-
-    for (int i = 0; i < n; i++) {
-        temp[i] = arr[i];
-    }
-
-    int start = temp[0];
-    sort(temp, n);
-
-    int pos = 0;
-    for (int i = 0; i < n; i++) {
-        if (temp[i] == start) {
-            pos = i;
-            break;
-        }
-    }
-
-    int total = 0;
-    int current = start;
-
-    // Move right
-    for (int i = pos + 1; i < n; i++) {
-        total += diff(current, temp[i]);
-        current = temp[i];
-    }
-
-    // Then move left
-    for (int i = pos - 1; i >= 0; i--) {
-        total += diff(current, temp[i]);
-        current = temp[i];
-    }
-
-    return total;
-}
-
-// ---------------- C-LOOK ----------------
-int clook(int arr[], int n) {
-    int temp[MAX];
-
-    for (int i = 0; i < n; i++) {
-        temp[i] = arr[i];
-    }
-
-    int start = temp[0];
-    sort(temp, n);
-
-    int pos = 0;
-    for (int i = 0; i < n; i++) {
-        if (temp[i] == start) {
-            pos = i;
-            break;
-        }
-    }
-
-    int total = 0;
-    int current = start;
-
-    // Move right
-    for (int i = pos + 1; i < n; i++) {
-        total += diff(current, temp[i]);
-        current = temp[i];
-    }
-
-    // Jump to smallest
-    if (pos > 0) {
-        total += diff(current, temp[0]);
-        current = temp[0];
-    }
-
-    // Continue up to start position
-    for (int i = 1; i < pos; i++) {
-        total += diff(current, temp[i]);
-        current = temp[i];
-    }
-
-    return total;
-}
-
-// ---------------- MAIN ----------------
-int main() {
-    int arr[MAX];
-    int n = 0;
-
-    // Read input
-    while (scanf("%d", &arr[n]) != EOF && n < MAX) {
-        n++;
-    }
-
-    printf("Assignment 7: Block Access Algorithm\n");
-    printf("By: Your Name\n\n");
-
-    printf("FCFS Total Seek: %d\n", fcfs(arr, n));
-    printf("SSTF Total Seek: %d\n", sstf(arr, n));
-    printf("LOOK Total Seek: %d\n", look(arr, n));
-    printf("C-LOOK Total Seek: %d\n", clook(arr, n));
-
-    return 0;
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// A request: block number and its position in the input
+typedef struct {
+    int64_t value;
+    int index;
+} request_t;
+
+// The trace sorted once by block (equal blocks in input order), shared
+// read-only by every algorithm that works in sorted order. head is the rank
+// of the start block arr[0], i.e. its first occurrence.
+typedef struct {
+    request_t *reqs;
+    int n;
+    int head;
+} sorted_view_t;
+
+// Function prototypes
+long long fcfs(const int64_t arr[], int n, int nthreads);
+long long sstf(const sorted_view_t *view);
+long long look(const sorted_view_t *view);
+long long clook(const sorted_view_t *view);
+
+// Absolute difference
+int64_t diff(int64_t a, int64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+// malloc that gives up on failure
+void *xmalloc(size_t size) {
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        perror("malloc");
+        exit(1);
+    }
+    return p;
+}
+
+// realloc that gives up on failure
+void *xrealloc(void *old, size_t size) {
+    void *p = realloc(old, size ? size : 1);
+    if (!p) {
+        perror("realloc");
+        exit(1);
+    }
+    return p;
+}
+
+// ---------------- FCFS ----------------
+// Total seek over a[0..n): the sum of |a[i+1] - a[i]|.
+typedef long long (*seek_kernel_t)(const int64_t *a, size_t n);
+
+long long seek_sum_scalar(const int64_t *a, size_t n) {
+    long long total = 0;
+
+    for (size_t i = 0; i + 1 < n; i++) {
+        total += diff(a[i], a[i + 1]);
+    }
+
+    return total;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// |d| in 64-bit lanes is (d ^ m) - m with m = (d < 0 ? -1 : 0).
+__attribute__((target("sse4.2")))
+long long seek_sum_sse42(const int64_t *a, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero;
+    size_t i = 0;
+
+    for (; i + 4 < n; i += 4) {
+        __m128i d0 = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(a + i + 1)),
+                                   _mm_loadu_si128((const __m128i *)(a + i)));
+        __m128i d1 = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(a + i + 3)),
+                                   _mm_loadu_si128((const __m128i *)(a + i + 2)));
+        __m128i m0 = _mm_cmpgt_epi64(zero, d0);
+        __m128i m1 = _mm_cmpgt_epi64(zero, d1);
+        acc0 = _mm_add_epi64(acc0, _mm_sub_epi64(_mm_xor_si128(d0, m0), m0));
+        acc1 = _mm_add_epi64(acc1, _mm_sub_epi64(_mm_xor_si128(d1, m1), m1));
+    }
+
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + seek_sum_scalar(a + i, n - i);
+}
+
+// Same as above, four lanes per vector and two vectors per step.
+__attribute__((target("avx2")))
+long long seek_sum_avx2(const int64_t *a, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero;
+    size_t i = 0;
+
+    for (; i + 8 < n; i += 8) {
+        __m256i d0 = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(a + i + 1)),
+                                      _mm256_loadu_si256((const __m256i *)(a + i)));
+        __m256i d1 = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(a + i + 5)),
+                                      _mm256_loadu_si256((const __m256i *)(a + i + 4)));
+        __m256i m0 = _mm256_cmpgt_epi64(zero, d0);
+        __m256i m1 = _mm256_cmpgt_epi64(zero, d1);
+        acc0 = _mm256_add_epi64(acc0, _mm256_sub_epi64(_mm256_xor_si256(d0, m0), m0));
+        acc1 = _mm256_add_epi64(acc1, _mm256_sub_epi64(_mm256_xor_si256(d1, m1), m1));
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + seek_sum_scalar(a + i, n - i);
+}
+#endif
+
+// Picked in main before any trace is read.
+seek_kernel_t seek_kernel = seek_sum_scalar;
+
+void select_seek_kernel(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) seek_kernel = seek_sum_avx2;
+    else if (__builtin_cpu_supports("sse4.2")) seek_kernel = seek_sum_sse42;
+#endif
+}
+
+// Below this many blocks per thread the threads cost more than they save.
+#define FCFS_MIN_CHUNK (1 << 20)
+
+typedef struct {
+    const int64_t *a;
+    size_t n;
+    long long total;
+} seek_chunk_t;
+
+void *seek_chunk_main(void *arg) {
+    seek_chunk_t *c = arg;
+    c->total = seek_kernel(c->a, c->n);
+    return NULL;
+}
+
+// Splits the trace into one chunk per thread. Each chunk also reads the
+// first block of the next one, so the seek across every boundary is
+// counted exactly once.
+long long fcfs(const int64_t arr[], int n, int nthreads) {
+    if (n < 2) return 0;
+    size_t pairs = (size_t)n - 1;
+    if ((size_t)nthreads > pairs / FCFS_MIN_CHUNK) nthreads = (int)(pairs / FCFS_MIN_CHUNK);
+    if (nthreads <= 1) return seek_kernel(arr, n);
+
+    seek_chunk_t *chunks = xmalloc(nthreads * sizeof(seek_chunk_t));
+    pthread_t *threads = xmalloc(nthreads * sizeof(pthread_t));
+    for (int t = 0; t < nthreads; t++) {
+        size_t lo = pairs * t / nthreads;
+        size_t hi = pairs * (t + 1) / nthreads;
+        chunks[t].a = arr + lo;
+        chunks[t].n = hi - lo + 1;
+    }
+
+    // A chunk whose thread fails to start runs on this one.
+    int *started = xmalloc(nthreads * sizeof(int));
+    for (int t = 1; t < nthreads; t++) {
+        started[t] = pthread_create(&threads[t], NULL, seek_chunk_main, &chunks[t]) == 0;
+    }
+    seek_chunk_main(&chunks[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (started[t]) pthread_join(threads[t], NULL);
+        else seek_chunk_main(&chunks[t]);
+    }
+
+    long long total = 0;
+    for (int t = 0; t < nthreads; t++) total += chunks[t].total;
+    free(started);
+    free(threads);
+    free(chunks);
+    return total;
+}
+
+// ---------------- SORTED VIEW ----------------
+// Flips the sign bit so signed blocks sort correctly as unsigned keys.
+uint64_t radix_key(int64_t v) {
+    return (uint64_t)v ^ (1ULL << 63);
+}
+
+// LSD radix sort, one byte per pass. It is stable, so equal blocks keep
+// their input order. A pass is skipped when every key has the same byte
+// there, which leaves two to four passes for typical block numbers.
+void radix_sort(request_t *a, request_t *tmp, int n) {
+    static size_t count[8][256];
+    memset(count, 0, sizeof(count));
+
+    for (int i = 0; i < n; i++) {
+        uint64_t k = radix_key(a[i].value);
+        for (int b = 0; b < 8; b++) {
+            count[b][(k >> (8 * b)) & 0xff]++;
+        }
+    }
+
+    request_t *src = a;
+    request_t *dst = tmp;
+
+    for (int b = 0; b < 8; b++) {
+        int shift = 8 * b;
+        if (n == 0 || count[b][(radix_key(src[0].value) >> shift) & 0xff] == (size_t)n) continue;
+
+        size_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t c = count[b][d];
+            count[b][d] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) {
+            unsigned d = (unsigned)(radix_key(src[i].value) >> shift) & 0xff;
+            dst[count[b][d]++] = src[i];
+        }
+
+        request_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != a) memcpy(a, src, n * sizeof(request_t));
+}
+
+sorted_view_t build_sorted_view(const int64_t arr[], int n) {
+    sorted_view_t view;
+    view.reqs = xmalloc(n * sizeof(request_t));
+    view.n = n;
+    view.head = 0;
+
+    for (int i = 0; i < n; i++) {
+        view.reqs[i].value = arr[i];
+        view.reqs[i].index = i;
+    }
+
+    request_t *tmp = xmalloc(n * sizeof(request_t));
+    radix_sort(view.reqs, tmp, n);
+    free(tmp);
+
+    if (n > 0) {
+        // first occurrence of the start block, which is request 0 itself
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (view.reqs[mid].value < arr[0]) lo = mid + 1;
+            else hi = mid;
+        }
+        view.head = lo;
+    }
+
+    return view;
+}
+
+void free_sorted_view(sorted_view_t *view) {
+    free(view->reqs);
+    view->reqs = NULL;
+}
+
+// ---------------- SSTF ----------------
+// Whatever SSTF has served always forms one contiguous run of the sorted
+// requests around the start, so the nearest pending request is the first
+// one past either end of that run. With the sorted view this is two
+// cursors walking outward, O(n).
+//
+// Requests for the same block are served back to back (the rest are zero
+// distance once the head is there), so a block is taken as a whole group.
+// Equal distances go to the group with the lower input index, the same
+// choice the first-match scan made; the sort is stable, so that index is
+// the one at the group's low end.
+long long sstf(const sorted_view_t *view) {
+    const request_t *reqs = view->reqs;
+    int n = view->n;
+    if (n < 2) return 0;
+
+    long long total = 0;
+    int64_t current = reqs[view->head].value;
+
+    int right = view->head + 1;
+    int left = view->head - 1;
+    int leftStart = -1;  // low end of the group ending at left
+
+    while (left >= 0 || right < n) {
+        if (left >= 0 && leftStart < 0) {
+            leftStart = left;
+            while (leftStart > 0 && reqs[leftStart - 1].value == reqs[left].value) leftStart--;
+        }
+
+        int goLeft;
+        if (left < 0) {
+            goLeft = 0;
+        } else if (right >= n) {
+            goLeft = 1;
+        } else {
+            int64_t dl = diff(current, reqs[left].value);
+            int64_t dr = diff(current, reqs[right].value);
+            if (dl != dr) goLeft = dl < dr;
+            else goLeft = reqs[leftStart].index < reqs[right].index;
+        }
+
+        if (goLeft) {
+            total += diff(current, reqs[left].value);
+            current = reqs[left].value;
+            left = leftStart - 1;
+            leftStart = -1;
+        } else {
+            total += diff(current, reqs[right].value);
+            current = reqs[right].value;
+            while (right < n && reqs[right].value == current) right++;
+        }
+    }
+
+    return total;
+}
+
+// ---------------- LOOK ----------------
+long long look(const sorted_view_t *view) {
+    const request_t *temp = view->reqs;
+    int n = view->n;
+    int pos = view->head;
+    if (n == 0) return 0;
+
+    long long total = 0;
+    int64_t current = temp[pos].value;
+
+    // Move right
+    for (int i = pos + 1; i < n; i++) {
+        total += diff(current, temp[i].value);
+        current = temp[i].value;
+    }
+
+    // Then move left
+    for (int i = pos - 1; i >= 0; i--) {
+        total += diff(current, temp[i].value);
+        current = temp[i].value;
+    }
+
+    return total;
+}
+
+// ---------------- C-LOOK ----------------
+long long clook(const sorted_view_t *view) {
+    const request_t *temp = view->reqs;
+    int n = view->n;
+    int pos = view->head;
+    if (n == 0) return 0;
+
+    long long total = 0;
+    int64_t current = temp[pos].value;
+
+    // Move right
+    for (int i = pos + 1; i < n; i++) {
+        total += diff(current, temp[i].value);
+        current = temp[i].value;
+    }
+
+    // Jump to smallest
+    if (pos > 0) {
+        total += diff(current, temp[0].value);
+        current = temp[0].value;
+    }
+
+    // Continue up to start position
+    for (int i = 1; i < pos; i++) {
+        total += diff(current, temp[i].value);
+        current = temp[i].value;
+    }
+
+    return total;
+}
+
+// SCAN, C-SCAN and N-step SCAN below assume every request is present from
+// the start, with the head on the first one (static mode). Timed runs go
+// through simulate().
+
+// ---------------- SCAN ----------------
+// LOOK, except the head runs on to the last block of the disk before it
+// turns back.
+long long scan(const sorted_view_t *view, long long disk_size) {
+    const request_t *temp = view->reqs;
+    int n = view->n;
+    int pos = view->head;
+    if (n == 0) return 0;
+
+    int64_t start = temp[pos].value;
+    if (pos == 0) return temp[n - 1].value - start;
+
+    long long edge = disk_size - 1;
+    return (edge - start) + (edge - temp[0].value);
+}
+
+// ---------------- C-SCAN ----------------
+// Up to the last block of the disk, back to block 0, then up to the
+// highest request below the start.
+long long cscan(const sorted_view_t *view, long long disk_size) {
+    const request_t *temp = view->reqs;
+    int n = view->n;
+    int pos = view->head;
+    if (n == 0) return 0;
+
+    int64_t start = temp[pos].value;
+    if (pos == 0) return temp[n - 1].value - start;
+
+    long long edge = disk_size - 1;
+    return (edge - start) + edge + temp[pos - 1].value;
+}
+
+// ---------------- N-STEP SCAN ----------------
+// LOOK over consecutive batches of `batch` requests in input order. The
+// sweep direction carries over from one batch to the next, and each batch
+// only needs its lowest and highest block. FSCAN is a single batch.
+long long nstep_scan(const int64_t arr[], int n, int batch) {
+    if (n == 0) return 0;
+
+    long long total = 0;
+    int64_t head = arr[0];
+    int up = 1;
+
+    for (int lo = 0, hi; lo < n; lo = hi) {
+        hi = n - lo > batch ? lo + batch : n;
+        int64_t min = arr[lo], max = arr[lo];
+        for (int i = lo + 1; i < hi; i++) {
+            if (arr[i] < min) min = arr[i];
+            if (arr[i] > max) max = arr[i];
+        }
+
+        if (up && max < head) up = 0;
+        else if (!up && min > head) up = 1;
+
+        if (up) {
+            total += max - head;
+            if (min < head) {
+                total += max - min;
+                head = min;
+                up = 0;
+            } else {
+                head = max;
+            }
+        } else {
+            total += head - min;
+            if (max > head) {
+                total += max - min;
+                head = max;
+                up = 1;
+            } else {
+                head = min;
+            }
+        }
+    }
+
+    return total;
+}
+
+// ---------------- TRACES ----------------
+// A trace is three columns: block (LBA), arrival time in ms and op ('R' or
+// 'W'). Text input fills heap columns; a binary trace is mapped and its
+// columns are used where they lie in the file.
+//
+// Binary layout (native byte order, little-endian in practice): a 64-byte
+// header, then count int64 LBAs, count double times and count op bytes.
+// The offsets in the header say where each column starts.
+#define TRACE_MAGIC "P7TRACE1"
+#define TRACE_HEADER_SIZE 64
+
+typedef struct {
+    char magic[8];
+    uint64_t count;
+    uint64_t lba_offset;
+    uint64_t time_offset;
+    uint64_t op_offset;
+    uint8_t reserved[TRACE_HEADER_SIZE - 40];
+} trace_header_t;
+
+typedef struct {
+    const int64_t *lba;
+    const double *time;
+    const unsigned char *op;
+    int n;
+    void *map;      // mapped file, or NULL
+    size_t map_len;
+    void *owned[3]; // heap columns from text input
+} trace_t;
+
+// Reads blocks (or "time block" pairs when timed) from a text stream.
+// A plain block list gets time 0 for every request.
+int read_text_trace(FILE *in, int timed, trace_t *tr) {
+    size_t cap = 1024;
+    int n = 0;
+    int64_t *lba = xmalloc(cap * sizeof(int64_t));
+    double *time = xmalloc(cap * sizeof(double));
+    double t = 0;
+    long long block;
+
+    // Read input
+    while (timed ? fscanf(in, "%lf %lld", &t, &block) == 2 : fscanf(in, "%lld", &block) == 1) {
+        if (n == INT_MAX) {
+            fprintf(stderr, "Error: too many requests\n");
+            free(lba);
+            free(time);
+            return 1;
+        }
+        if ((size_t)n == cap) {
+            cap *= 2;
+            lba = xrealloc(lba, cap * sizeof(int64_t));
+            time = xrealloc(time, cap * sizeof(double));
+        }
+        lba[n] = block;
+        time[n] = t;
+        n++;
+    }
+
+    unsigned char *op = xmalloc(n);
+    memset(op, 'R', n);
+
+    memset(tr, 0, sizeof(*tr));
+    tr->lba = lba;
+    tr->time = time;
+    tr->op = op;
+    tr->n = n;
+    tr->owned[0] = lba;
+    tr->owned[1] = time;
+    tr->owned[2] = op;
+    return 0;
+}
+
+int map_binary_trace(const char *path, trace_t *tr) {
+    memset(tr, 0, sizeof(*tr));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    size_t len = (size_t)st.st_size;
+    if (len < TRACE_HEADER_SIZE) {
+        fprintf(stderr, "Error: %s is not a binary trace\n", path);
+        close(fd);
+        return 1;
+    }
+
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    const trace_header_t *h = map;
+    uint64_t n = h->count;
+    int ok = memcmp(h->magic, TRACE_MAGIC, 8) == 0 && n <= INT_MAX &&
+             h->lba_offset % 8 == 0 && h->time_offset % 8 == 0 &&
+             h->lba_offset <= len && (len - h->lba_offset) / 8 >= n &&
+             h->time_offset <= len && (len - h->time_offset) / 8 >= n &&
+             h->op_offset <= len && len - h->op_offset >= n;
+    if (!ok) {
+        fprintf(stderr, "Error: %s is not a valid binary trace\n", path);
+        munmap(map, len);
+        return 1;
+    }
+
+    const char *base = map;
+    tr->lba = (const int64_t *)(base + h->lba_offset);
+    tr->time = (const double *)(base + h->time_offset);
+    tr->op = (const unsigned char *)(base + h->op_offset);
+    tr->n = (int)n;
+    tr->map = map;
+    tr->map_len = len;
+    return 0;
+}
+
+int write_binary_trace(const char *path, const trace_t *tr) {
+    trace_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, 8);
+    h.count = tr->n;
+    h.lba_offset = TRACE_HEADER_SIZE;
+    h.time_offset = h.lba_offset + 8 * h.count;
+    h.op_offset = h.time_offset + 8 * h.count;
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+    size_t n = tr->n;
+    int ok = fwrite(&h, sizeof(h), 1, out) == 1 &&
+             fwrite(tr->lba, sizeof(int64_t), n, out) == n &&
+             fwrite(tr->time, sizeof(double), n, out) == n &&
+             fwrite(tr->op, 1, n, out) == n;
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        perror(path);
+        return 1;
+    }
+    return 0;
+}
+
+void free_trace(trace_t *tr) {
+    if (tr->map) munmap(tr->map, tr->map_len);
+    for (int i = 0; i < 3; i++) free(tr->owned[i]);
+    memset(tr, 0, sizeof(*tr));
+}
+
+// ---------------- TIMED SIMULATION ----------------
+// Requests arrive over time and the disk serves one at a time, choosing
+// among the requests that have arrived by the time it frees up. Times are
+// in milliseconds.
+typedef enum {
+    ALG_FCFS,
+    ALG_SSTF,
+    ALG_LOOK,
+    ALG_CLOOK,
+    ALG_SCAN,
+    ALG_CSCAN,
+    ALG_NSTEP,
+    ALG_FSCAN,
+    ALG_DEADLINE,
+    ALG_COUNT
+} algorithm_t;
+
+const char *algorithm_names[ALG_COUNT] = {
+    "FCFS", "SSTF", "LOOK", "C-LOOK", "SCAN", "C-SCAN", "N-Step SCAN", "FSCAN", "Deadline"
+};
+
+// Requests the deadline scheduler sends in sorted order before it looks
+// at the FIFO again (mq-deadline's fifo_batch)
+#define DEADLINE_FIFO_BATCH 16
+
+// Service time for one request: seek (settle + linear and square-root
+// terms in the distance, none for a zero-distance seek), plus average
+// rotational latency and transfer time.
+typedef struct {
+    double settle;
+    double linear;
+    double sqrt_coef;
+    double rotation;
+    double transfer;
+} cost_model_t;
+
+typedef struct {
+    cost_model_t cost;
+    long long disk_size;  // blocks; 0 if unknown (SCAN and C-SCAN need it)
+    int nstep;            // N-step SCAN batch size; 0 disables it
+    int fscan;
+    double expire;        // deadline expiry in ms; 0 disables the deadline scheduler
+} sim_config_t;
+
+typedef struct {
+    long long total_seek;
+    double mean;
+    double p50, p90, p99, p999, max;
+    double throughput;  // requests per second
+} sim_result_t;
+
+// Fenwick tree counting pending requests per block rank. Nearest pending
+// block at or above / at or below a rank takes O(log n).
+typedef struct {
+    int *tree;
+    int n;
+    int top;  // highest power of two <= n
+    int total;
+} fenwick_t;
+
+void fenwick_init(fenwick_t *f, int n) {
+    f->tree = xmalloc((n + 1) * sizeof(int));
+    memset(f->tree, 0, (n + 1) * sizeof(int));
+    f->n = n;
+    f->top = 1;
+    while (f->top * 2 <= n) f->top *= 2;
+    f->total = 0;
+}
+
+void fenwick_add(fenwick_t *f, int rank, int delta) {
+    f->total += delta;
+    for (int i = rank + 1; i <= f->n; i += i & -i) f->tree[i] += delta;
+}
+
+// Number of pending requests with rank < r
+int fenwick_prefix(const fenwick_t *f, int r) {
+    int sum = 0;
+    for (int i = r; i > 0; i -= i & -i) sum += f->tree[i];
+    return sum;
+}
+
+// Rank holding the k-th pending request (k >= 1)
+int fenwick_kth(const fenwick_t *f, int k) {
+    int pos = 0;
+    for (int step = f->top; step > 0; step >>= 1) {
+        if (pos + step <= f->n && f->tree[pos + step] < k) {
+            pos += step;
+            k -= f->tree[pos];
+        }
+    }
+    return pos;
+}
+
+// Lowest pending rank >= r, or -1
+int fenwick_next(const fenwick_t *f, int r) {
+    int before = fenwick_prefix(f, r);
+    return before == f->total ? -1 : fenwick_kth(f, before + 1);
+}
+
+// Highest pending rank <= r, or -1
+int fenwick_prev(const fenwick_t *f, int r) {
+    int upto = fenwick_prefix(f, r + 1);
+    return upto == 0 ? -1 : fenwick_kth(f, upto);
+}
+
+// Requests for one block form a contiguous run of the sorted view, in
+// arrival order. Pending ones are served from the front of the run.
+typedef struct {
+    const sorted_view_t *view;
+    int ngroups;
+    int64_t *group_value;
+    int *group_next;    // view position of the group's next unserved request
+    int *group_of;      // request index -> group
+    fenwick_t pending;
+} block_index_t;
+
+void block_index_init(block_index_t *bi, const sorted_view_t *view) {
+    int n = view->n;
+    bi->view = view;
+    bi->group_value = xmalloc(n * sizeof(int64_t));
+    bi->group_next = xmalloc(n * sizeof(int));
+    bi->group_of = xmalloc(n * sizeof(int));
+
+    int g = -1;
+    for (int i = 0; i < n; i++) {
+        if (i == 0 || view->reqs[i].value != view->reqs[i - 1].value) {
+            g++;
+            bi->group_value[g] = view->reqs[i].value;
+            bi->group_next[g] = i;
+        }
+        bi->group_of[view->reqs[i].index] = g;
+    }
+    bi->ngroups = g + 1;
+    fenwick_init(&bi->pending, bi->ngroups);
+}
+
+void block_index_free(block_index_t *bi) {
+    free(bi->group_value);
+    free(bi->group_next);
+    free(bi->group_of);
+    free(bi->pending.tree);
+}
+
+// First group whose block is >= value
+int block_lower_bound(const block_index_t *bi, int64_t value) {
+    int lo = 0, hi = bi->ngroups;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (bi->group_value[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Scheduler state carried between picks
+typedef struct {
+    int up;          // sweep direction
+    int batch_left;  // deadline: sorted dispatches left before the FIFO check
+    int oldest;      // deadline: lowest request index that may be pending
+    unsigned char *served;
+} sched_state_t;
+
+// Picks the next group to serve with the head at `head` at time t, or -1
+// if nothing is pending, and sets *distance to the head travel needed to
+// reach it. SCAN runs to the disk edge before reversing and C-SCAN runs to
+// the edge and returns to block 0; that travel is counted as seek.
+// N-step SCAN and FSCAN sweep LOOK-style over whichever batch is loaded
+// into the pending tree.
+int pick_group(const block_index_t *bi, algorithm_t alg, const sim_config_t *cfg,
+               const double times[], double t, int64_t head, sched_state_t *st,
+               long long *distance) {
+    const fenwick_t *f = &bi->pending;
+    int ge = block_lower_bound(bi, head);
+    int le = ge < bi->ngroups && bi->group_value[ge] == head ? ge : ge - 1;
+    int above = ge < bi->ngroups ? fenwick_next(f, ge) : -1;
+    int below = le >= 0 ? fenwick_prev(f, le) : -1;
+    long long edge = cfg->disk_size - 1;
+    int g = -1;
+
+    if (above < 0 && below < 0) return -1;
+
+    switch (alg) {
+    case ALG_SSTF:
+        if (above < 0) {
+            g = below;
+        } else if (below < 0) {
+            g = above;
+        } else {
+            int64_t da = diff(head, bi->group_value[above]);
+            int64_t db = diff(head, bi->group_value[below]);
+            if (da != db) {
+                g = da < db ? above : below;
+            } else {
+                // equal distance: the earlier request wins
+                int ia = bi->view->reqs[bi->group_next[above]].index;
+                int ib = bi->view->reqs[bi->group_next[below]].index;
+                g = ia < ib ? above : below;
+            }
+        }
+        break;
+    case ALG_LOOK:
+    case ALG_NSTEP:
+    case ALG_FSCAN:
+        if (st->up && above < 0) st->up = 0;
+        else if (!st->up && below < 0) st->up = 1;
+        g = st->up ? above : below;
+        break;
+    case ALG_CLOOK:
+        g = above >= 0 ? above : fenwick_next(f, 0);
+        break;
+    case ALG_SCAN:
+        if (st->up && above < 0) {
+            st->up = 0;
+            *distance = (edge - head) + (edge - bi->group_value[below]);
+            return below;
+        }
+        if (!st->up && below < 0) {
+            st->up = 1;
+            *distance = head + bi->group_value[above];
+            return above;
+        }
+        g = st->up ? above : below;
+        break;
+    case ALG_CSCAN:
+        if (above < 0) {
+            g = fenwick_next(f, 0);
+            *distance = (edge - head) + edge + bi->group_value[g];
+            return g;
+        }
+        g = above;
+        break;
+    case ALG_DEADLINE:
+        // Dispatch in ascending block order, wrapping like C-LOOK, but
+        // after every batch restart from the oldest request if it expired.
+        while (st->served[st->oldest]) st->oldest++;
+        if (st->batch_left == 0) {
+            st->batch_left = DEADLINE_FIFO_BATCH;
+            if (times[st->oldest] + cfg->expire <= t) g = bi->group_of[st->oldest];
+        }
+        st->batch_left--;
+        if (g < 0) g = above >= 0 ? above : fenwick_next(f, 0);
+        break;
+    case ALG_FCFS:
+    case ALG_COUNT:
+        break;
+    }
+
+    *distance = diff(bi->group_value[g], head);
+    return g;
+}
+
+double service_time(const cost_model_t *cost, long long distance) {
+    double t = cost->rotation + cost->transfer;
+    if (distance > 0) {
+        t += cost->settle + cost->linear * distance + cost->sqrt_coef * sqrt((double)distance);
+    }
+    return t;
+}
+
+int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+double percentile(const double *sorted, int n, double q) {
+    long long rank = (long long)ceil(q * n);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+// Runs one algorithm over requests (times[i], blocks[i]), which must be in
+// arrival order. The head starts at block `head`.
+sim_result_t simulate(const double times[], const int64_t blocks[], int n,
+                      const sorted_view_t *view, algorithm_t alg,
+                      const sim_config_t *cfg, int64_t head) {
+    sim_result_t res;
+    memset(&res, 0, sizeof(res));
+    if (n == 0) return res;
+
+    block_index_t bi;
+    block_index_init(&bi, view);
+    double *latency = xmalloc(n * sizeof(double));
+    sched_state_t st = {1, 0, 0, xmalloc(n)};
+    memset(st.served, 0, n);
+
+    double t = 0;
+    int arrived = 0;
+    int admitted = 0;  // arrived requests loaded into the pending tree
+    double sum = 0;
+
+    for (int served = 0; served < n; served++) {
+        if (arrived == served && t < times[arrived]) t = times[arrived];
+        while (arrived < n && times[arrived] <= t) arrived++;
+
+        // N-step SCAN and FSCAN only take a new batch once the current
+        // one is done; everything else sees every arrived request.
+        int limit = arrived;
+        if (alg == ALG_NSTEP || alg == ALG_FSCAN) {
+            limit = admitted;
+            if (bi.pending.total == 0) {
+                limit = alg == ALG_FSCAN || arrived - admitted < cfg->nstep ? arrived : admitted + cfg->nstep;
+            }
+        }
+        while (admitted < limit) {
+            fenwick_add(&bi.pending, bi.group_of[admitted], 1);
+            admitted++;
+        }
+
+        int r;
+        long long distance;
+        if (alg == ALG_FCFS) {
+            r = served;
+            fenwick_add(&bi.pending, bi.group_of[r], -1);
+            distance = diff(blocks[r], head);
+        } else {
+            int g = pick_group(&bi, alg, cfg, times, t, head, &st, &distance);
+            r = view->reqs[bi.group_next[g]++].index;
+            fenwick_add(&bi.pending, g, -1);
+        }
+        st.served[r] = 1;
+
+        res.total_seek += distance;
+        t += service_time(&cfg->cost, distance);
+        head = blocks[r];
+
+        latency[served] = t - times[r];
+        sum += latency[served];
+    }
+
+    qsort(latency, n, sizeof(double), cmp_double);
+    res.mean = sum / n;
+    res.p50 = percentile(latency, n, 0.50);
+    res.p90 = percentile(latency, n, 0.90);
+    res.p99 = percentile(latency, n, 0.99);
+    res.p999 = percentile(latency, n, 0.999);
+    res.max = latency[n - 1];
+    double span = t - times[0];
+    res.throughput = span > 0 ? n / (span / 1000.0) : 0;
+
+    free(latency);
+    free(st.served);
+    block_index_free(&bi);
+    return res;
+}
+
+// Smallest pending group >= g (ngroups if none). Served-out groups point
+// past themselves; lookups halve the path as they go.
+int next_pending(int *next, int g) {
+    while (next[g] != g) {
+        next[g] = next[next[g]];
+        g = next[g];
+    }
+    return g;
+}
+
+// The deadline scheduler with every request present at time 0 and the
+// head on the first one. Expiry still depends on the clock, which the
+// service times advance, but the only lookups are the next pending block
+// at or above the head and the oldest pending request.
+long long deadline(const sorted_view_t *view, const sim_config_t *cfg) {
+    const request_t *reqs = view->reqs;
+    int n = view->n;
+    if (n == 0) return 0;
+
+    int *group_start = xmalloc((n + 1) * sizeof(int));
+    int *group_next = xmalloc(n * sizeof(int));
+    int *group_of = xmalloc(n * sizeof(int));
+    int *next = xmalloc((n + 1) * sizeof(int));
+    unsigned char *served = xmalloc(n);
+    memset(served, 0, n);
+
+    int ngroups = 0;
+    for (int i = 0; i < n; i++) {
+        if (i == 0 || reqs[i].value != reqs[i - 1].value) {
+            group_start[ngroups] = i;
+            group_next[ngroups] = i;
+            next[ngroups] = ngroups;
+            ngroups++;
+        }
+        group_of[reqs[i].index] = ngroups - 1;
+    }
+    group_start[ngroups] = n;
+    next[ngroups] = ngroups;
+
+    long long total = 0;
+    double t = 0;
+    int hg = group_of[reqs[view->head].index];  // group under the head
+    int batch_left = 0;
+    int oldest = 0;
+
+    for (int done = 0; done < n; done++) {
+        int g = -1;
+        while (served[oldest]) oldest++;
+        if (batch_left == 0) {
+            batch_left = DEADLINE_FIFO_BATCH;
+            if (cfg->expire <= t) g = group_of[oldest];
+        }
+        batch_left--;
+        if (g < 0) {
+            g = next_pending(next, hg);
+            if (g == ngroups) g = next_pending(next, 0);
+        }
+
+        long long distance = diff(reqs[group_start[g]].value, reqs[group_start[hg]].value);
+        served[reqs[group_next[g]++].index] = 1;
+        if (group_next[g] == group_start[g + 1]) next[g] = g + 1;
+
+        total += distance;
+        t += service_time(&cfg->cost, distance);
+        hg = g;
+    }
+
+    free(group_start);
+    free(group_next);
+    free(group_of);
+    free(next);
+    free(served);
+    return total;
+}
+
+void print_sim_result(const char *name, const sim_result_t *r) {
+    printf("%s Total Seek: %lld, Mean Latency: %.3f, p50: %.3f, p90: %.3f, p99: %.3f, "
+           "p99.9: %.3f, Max: %.3f, Throughput: %.1f req/s\n",
+           name, r->total_seek, r->mean, r->p50, r->p90, r->p99, r->p999, r->max, r->throughput);
+}
+
+// FCFS, SSTF, LOOK and C-LOOK always run; the rest when configured.
+int algorithm_enabled(algorithm_t alg, const sim_config_t *cfg) {
+    switch (alg) {
+    case ALG_SCAN:
+    case ALG_CSCAN: return cfg->disk_size > 0;
+    case ALG_NSTEP: return cfg->nstep > 0;
+    case ALG_FSCAN: return cfg->fscan;
+    case ALG_DEADLINE: return cfg->expire > 0;
+    default: return 1;
+    }
+}
+
+// SCAN and C-SCAN travel to the disk edges, so blocks must lie on the disk.
+int check_disk_size(const int64_t blocks[], int n, const sim_config_t *cfg) {
+    if (cfg->disk_size <= 0) return 1;
+    for (int i = 0; i < n; i++) {
+        if (blocks[i] < 0 || blocks[i] >= cfg->disk_size) {
+            fprintf(stderr, "Error: block %lld is outside a disk of %lld blocks\n",
+                    (long long)blocks[i], cfg->disk_size);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Simulates every enabled algorithm over a timed trace and prints them.
+int run_timed(const trace_t *tr, const sim_config_t *cfg, int64_t head) {
+    for (int i = 1; i < tr->n; i++) {
+        if (tr->time[i] < tr->time[i - 1]) {
+            fprintf(stderr, "Error: request %d arrives before the one ahead of it\n", i + 1);
+            return 1;
+        }
+    }
+    if (!check_disk_size(tr->lba, tr->n, cfg)) return 1;
+    if (cfg->disk_size > 0 && (head < 0 || head >= cfg->disk_size)) {
+        fprintf(stderr, "Error: head %lld is outside a disk of %lld blocks\n",
+                (long long)head, cfg->disk_size);
+        return 1;
+    }
+
+    printf("Assignment 7: Block Access Algorithm\n");
+    printf("By: Your Name\n\n");
+
+    sorted_view_t view = build_sorted_view(tr->lba, tr->n);
+    for (int a = 0; a < ALG_COUNT; a++) {
+        if (!algorithm_enabled((algorithm_t)a, cfg)) continue;
+        sim_result_t r = simulate(tr->time, tr->lba, tr->n, &view, (algorithm_t)a, cfg, head);
+        print_sim_result(algorithm_names[a], &r);
+    }
+
+    free_sorted_view(&view);
+    return 0;
+}
+
+// Seek totals for a plain block list, starting on the first block.
+int run_static(const trace_t *tr, const sim_config_t *cfg, int nthreads) {
+    const int64_t *arr = tr->lba;
+    int n = tr->n;
+    if (!check_disk_size(arr, n, cfg)) return 1;
+
+    printf("Assignment 7: Block Access Algorithm\n");
+    printf("By: Your Name\n\n");
+
+    printf("FCFS Total Seek: %lld\n", fcfs(arr, n, nthreads));
+    sorted_view_t view = build_sorted_view(arr, n);
+
+    printf("SSTF Total Seek: %lld\n", sstf(&view));
+    printf("LOOK Total Seek: %lld\n", look(&view));
+    printf("C-LOOK Total Seek: %lld\n", clook(&view));
+
+    if (algorithm_enabled(ALG_SCAN, cfg)) {
+        printf("SCAN Total Seek: %lld\n", scan(&view, cfg->disk_size));
+        printf("C-SCAN Total Seek: %lld\n", cscan(&view, cfg->disk_size));
+    }
+    if (algorithm_enabled(ALG_NSTEP, cfg)) {
+        printf("N-Step SCAN Total Seek: %lld\n", nstep_scan(arr, n, cfg->nstep));
+    }
+    if (algorithm_enabled(ALG_FSCAN, cfg)) {
+        printf("FSCAN Total Seek: %lld\n", nstep_scan(arr, n, n));
+    }
+
+    if (algorithm_enabled(ALG_DEADLINE, cfg)) {
+        printf("Deadline Total Seek: %lld\n", deadline(&view, cfg));
+    }
+
+    free_sorted_view(&view);
+    return 0;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-b trace.bin] [-w out.bin] [-j threads] < blocks\n", prog);
+    fprintf(stderr, "       %s -t [-H head] [-S settle] [-L per_block] [-Q sqrt_coef] [-R rotation] [-X transfer] < trace\n", prog);
+    fprintf(stderr, "  -t  timed mode: input is \"arrival_ms block\" pairs; reports latency and throughput\n");
+    fprintf(stderr, "  seek(d) = settle + per_block*d + sqrt_coef*sqrt(d) for d > 0, plus rotation + transfer per request\n");
+    fprintf(stderr, "  -b  read a binary trace (mapped in place) instead of text from stdin\n");
+    fprintf(stderr, "  -w  convert the text input to a binary trace and exit\n");
+    fprintf(stderr, "  -j  threads for the FCFS total on long traces (default: all cores)\n");
+    fprintf(stderr, "Extra algorithms (either mode):\n");
+    fprintf(stderr, "  -D size  SCAN and C-SCAN on a disk of this many blocks\n");
+    fprintf(stderr, "  -N n     N-step SCAN with batches of n requests\n");
+    fprintf(stderr, "  -F       FSCAN\n");
+    fprintf(stderr, "  -E ms    deadline scheduler; requests older than ms jump the sorted order\n");
+}
+
+// ---------------- MAIN ----------------
+int main(int argc, char *argv[]) {
+    sim_config_t cfg = {{0.5, 0.0, 0.05, 4.17, 0.05}, 0, 0, 0, 0};
+    cost_model_t *cost = &cfg.cost;
+    int timed = 0;
+    int64_t head = 0;
+    const char *binary = NULL;
+    const char *convert = NULL;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = cores > 0 ? (int)cores : 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "tH:S:L:Q:R:X:D:N:FE:b:w:j:")) != -1) {
+        switch (opt) {
+        case 't': timed = 1; break;
+        case 'H': head = atoll(optarg); break;
+        case 'S': cost->settle = atof(optarg); break;
+        case 'L': cost->linear = atof(optarg); break;
+        case 'Q': cost->sqrt_coef = atof(optarg); break;
+        case 'R': cost->rotation = atof(optarg); break;
+        case 'X': cost->transfer = atof(optarg); break;
+        case 'D': cfg.disk_size = atoll(optarg); break;
+        case 'N': cfg.nstep = atoi(optarg); break;
+        case 'F': cfg.fscan = 1; break;
+        case 'E': cfg.expire = atof(optarg); break;
+        case 'b': binary = optarg; break;
+        case 'w': convert = optarg; break;
+        case 'j': nthreads = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (cfg.disk_size < 0 || cfg.nstep < 0 || cfg.expire < 0 || nthreads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    select_seek_kernel();
+
+    trace_t tr;
+    if (binary ? map_binary_trace(binary, &tr) != 0 : read_text_trace(stdin, timed, &tr) != 0) return 1;
+
+    int status;
+    if (convert) status = write_binary_trace(convert, &tr);
+    else if (timed) status = run_timed(&tr, &cfg, head);
+    else status = run_static(&tr, &cfg, nthreads);
+
+    free_trace(&tr);
+    return status;
+}